@@ -20,6 +20,7 @@
 bool DEBUG_CHECK = false;
 bool BIG_MODE = false;
 bool DISABLE_TBB = false;
+bool MEM_PROFILE = false;
 
 bool InitAll(std::string const& data_dir) {
   InitEcc();
@@ -170,6 +171,7 @@ int main(int argc, char** argv) {
   bool iop = false;
   ParamIntPair r1cs;
   int64_t pack_n = 0;
+  int64_t adapt_aggregate_n = 0;
   ParamIntStr substrpack;
   ParamIntStr matchpack;
   Param2IntStr match_query;
@@ -178,6 +180,11 @@ int main(int argc, char** argv) {
   int64_t bp_p2_n = 0;
   int64_t bp_p31_n = 0;
   int64_t vrs_cache_n = 0;
+  std::vector<int64_t> vrs_cache_producer;
+  int64_t vrs_cache_pool = 2;
+  bool circuit_cache = false;
+  bool query_batch = false;
+  int64_t vrs_memory_budget = 0;
   int64_t pc_commitment_n = 0;
   int64_t multiexp_n = 0;
   int64_t mcl_n = 0;
@@ -199,7 +206,21 @@ int main(int argc, char** argv) {
         "policy", po::value<int>(&policy)->default_value(kOrdinary),
         "Provide the policy type, 0: ordinary(fast with large proof size), "
         "1:succinct(slow with small proof size)")(
-        "vrs_cache", po::value<int64_t>(&vrs_cache_n), "")("hyrax_a1", "")(
+        "vrs_cache", po::value<int64_t>(&vrs_cache_n), "")(
+        "vrs_cache_producer",
+        po::value<std::vector<int64_t>>(&vrs_cache_producer)->multitoken(),
+        "Keep vrs caches of these counts ready in the background, ex: 1024 "
+        "65536")(
+        "vrs_cache_pool", po::value<int64_t>(&vrs_cache_pool)->default_value(2),
+        "The number of ready vrs caches of every count")(
+        "circuit_cache",
+        "Save the compiled circuits to data_dir/circuit_cache and load them "
+        "from there")(
+        "query_batch",
+        "Prove all the rows of match_query/substr_query in one batch")(
+        "vrs_memory_budget", po::value<int64_t>(&vrs_memory_budget),
+        "The memory (MB) of the vrs chunks proved at once, 0: half of the "
+        "memory")("hyrax_a1", "")(
         "hyrax_a2", po::value<int64_t>(&hyrax_a2_n), "")(
         "hyrax_a3", po::value<int64_t>(&hyrax_a3_n), "")(
         "hyrax_a4", po::value<ParamIntPair>(&hyrax_a4), "m*n, ex: 10*20")(
@@ -219,6 +240,8 @@ int main(int argc, char** argv) {
         "equal_ip", po::value<ParamIntPair>(&equal_ip), "xn,yn, ex:10,20")(
         "overlap", "")("divide", "")("match", "")("substr", "")("circuit", "")(
         "pack", po::value<int64_t>(&pack_n), "n, ex: 31000")(
+        "adapt_aggregate", po::value<int64_t>(&adapt_aggregate_n),
+        "n, ex: 1000")(
         "substrpack", po::value<ParamIntStr>(&substrpack), "n,key, ex: 10,abc")(
         "matchpack", po::value<ParamIntStr>(&substrpack), "n,key, ex: 10,abc")(
         "match_query", po::value<Param2IntStr>(&substr_query),
@@ -237,7 +260,10 @@ int main(int argc, char** argv) {
         "\"test_image_path working_path\"")(
         "vgg16_prove", po::value<Param2Str>(&vgg16_prove),
         "test_image_path working_path")("vgg16_test", "")("sudoku", po::value<int64_t>(&sudoku_d), "")(
-        "debug_check", "")("big_mode", "")("disable_tbb", "");
+        "debug_check", "")("big_mode", "")("disable_tbb", "")(
+        "mem_profile",
+        "Track allocations and dump the peak memory of every Tick phase")(
+        "huge_pages", "Back the prover matrices with 2MB transparent huge pages");
 
     boost::program_options::variables_map vmap;
 
@@ -284,6 +310,20 @@ int main(int argc, char** argv) {
       debug::flags::disable_vrs_cache = true;
     }
 
+    if (vmap.count("circuit_cache")) {
+      circuit_cache = true;
+    }
+
+    if (vmap.count("query_batch")) {
+      query_batch = true;
+    }
+
+    debug::flags::vrs_memory_budget = vrs_memory_budget * 1024 * 1024;
+
+    if (vmap.count("huge_pages")) {
+      debug::flags::huge_pages = true;
+    }
+
     if (vmap.count("opening")) {
       opening = true;
     }
@@ -319,6 +359,10 @@ int main(int argc, char** argv) {
     if (vmap.count("disable_tbb")) {
       DISABLE_TBB = true;
     }
+
+    if (vmap.count("mem_profile")) {
+      MEM_PROFILE = true;
+    }
   } catch (std::exception& e) {
     std::cout << "Unknown parameters.\n"
               << e.what() << "\n"
@@ -333,8 +377,33 @@ int main(int argc, char** argv) {
     return -1;
   }
 
+  if (circuit_cache) {
+    clink::CircuitRegistry::Instance().set_cache_dir(data_dir +
+                                                     "/circuit_cache");
+  }
+
   std::map<std::string, bool> rets;
 
+  if (!vrs_cache_producer.empty()) {
+    // runs until killed
+    auto run = [&data_dir, &vrs_cache_producer, vrs_cache_pool](auto* scheme) {
+      using Scheme = std::remove_pointer_t<decltype(scheme)>;
+      typename clink::VrsCacheProducer<Scheme>::Options options;
+      options.pool_size = vrs_cache_pool;
+      clink::VrsCacheProducer<Scheme> producer(data_dir, vrs_cache_producer,
+                                               options);
+      producer.Run();
+    };
+    if (vrs_scheme == VrsSchemeType::kMimic5) {
+      run((clink::VrsMimc5Scheme*)nullptr);
+    } else if (vrs_scheme == VrsSchemeType::kSha256c) {
+      run((clink::VrsSha256cScheme*)nullptr);
+    } else if (vrs_scheme == VrsSchemeType::kPoseidon) {
+      run((clink::VrsPoseidonScheme*)nullptr);
+    }
+    return 0;
+  }
+
   if (vrs_cache_n) {
     if (vrs_scheme == VrsSchemeType::kMimic5) {
       using VrsCache = clink::VrsCache<clink::VrsMimc5Scheme>;
@@ -515,6 +584,11 @@ int main(int argc, char** argv) {
     }
   }
 
+  if (adapt_aggregate_n) {
+    rets["clink::adapt_aggregate"] =
+        clink::TestAdaptAggregate(adapt_aggregate_n);
+  }
+
   if (substrpack.valid()) {
     if (policy == PolicyType::kOrdinary) {
       rets["clink::substrpack(ordinary)"] =
@@ -543,11 +617,13 @@ int main(int argc, char** argv) {
     if (policy == PolicyType::kOrdinary) {
       rets["cmd::match_query(ordinary)"] =
           cmd::MatchQuery<groth09::OrdinaryPolicy>::Test(
-              match_query.n, match_query.s, match_query.str, data_dir);
+              match_query.n, match_query.s, match_query.str, data_dir,
+              query_batch);
     } else {
       rets["cmd::match_query(succinct)"] =
           cmd::MatchQuery<groth09::SuccinctPolicy>::Test(
-              match_query.n, match_query.s, match_query.str, data_dir);
+              match_query.n, match_query.s, match_query.str, data_dir,
+              query_batch);
     }
   }
 
@@ -555,11 +631,13 @@ int main(int argc, char** argv) {
     if (policy == PolicyType::kOrdinary) {
       rets["cmd::substr_query(ordinary)"] =
           cmd::SubstrQuery<groth09::OrdinaryPolicy>::Test(
-              substr_query.n, substr_query.s, substr_query.str, data_dir);
+              substr_query.n, substr_query.s, substr_query.str, data_dir,
+              query_batch);
     } else {
       rets["cmd::substr_query(succinct)"] =
           cmd::SubstrQuery<groth09::SuccinctPolicy>::Test(
-              substr_query.n, substr_query.s, substr_query.str, data_dir);
+              substr_query.n, substr_query.s, substr_query.str, data_dir,
+              query_batch);
     }
   }
 
@@ -725,5 +803,10 @@ int main(int argc, char** argv) {
     if (!i.second) all_success = false;
   }
 
+  if (MEM_PROFILE) {
+    std::cout << "\n";
+    mem::Dump(std::cout);
+  }
+
   return all_success ? 0 : 1;
 }
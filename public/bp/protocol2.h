@@ -178,70 +178,61 @@ bool Verify(h256_t seed, G1 p, G1 const& u, std::vector<G1>&& g1,
   assert(g1.size() == g2.size());
   UpdateSeed(seed, p, u, g1.size());
 
+  // the padding generators are zero, only the first n items count
   auto n = g1.size();
   auto align_n = misc::Pow2UB(n);
-  if (align_n > n) {
-    g1.resize(align_n, G1Zero());
-    g2.resize(align_n, G1Zero());
-  }
   auto rounds = misc::Log2UB(align_n);
   if (proof.left.size() != rounds || proof.right.size() != rounds) {
     assert(false);
     return false;
   }
 
+  std::vector<Fr> x(rounds);
+  std::vector<Fr> x_inv(rounds);
   std::vector<RoundX> rounds_x(rounds);
   for (size_t loop = 0; loop < rounds; ++loop) {
     GenerateRoundX(seed, rounds_x[loop]);
+    assert(!rounds_x[loop].x.isZero());
+    x[loop] = rounds_x[loop].x;
+    x_inv[loop] = rounds_x[loop].inv;
     UpdateSeed(seed, proof.left[loop], proof.right[loop]);
   }
 
-  // true: 1; false: -1
-  auto get_b = [rounds](size_t i, size_t j) -> bool {
-    auto pow_j = (size_t)1 << (rounds - 1 - j);
-    return (i & pow_j) ? true : false;
-  };
-
-  std::vector<Fr> ss(align_n);
-  std::vector<Fr> ss_inverse(align_n);
-  auto parallel_f = [&ss, &get_b, &rounds_x](size_t i) {
-    ss[i] = FrOne();
-    for (size_t j = 0; j < rounds_x.size(); ++j) {
-      auto b = get_b(i, j);
-      assert(!rounds_x[j].x.isZero());
-      ss[i] = ss[i] * (b ? rounds_x[j].x : rounds_x[j].inv);
-    }
-  };
-  parallel::For(align_n, parallel_f);
-  ss_inverse = ss;
-  FrInv(ss_inverse.data(), ss_inverse.size());
-
-  G1 last_g, last_h;
-
+  // ss[i] = prod(bit j of i ? x[j] : x_inv[j]), ss_inverse[i] = 1/ss[i]
+  std::vector<Fr> ss(n);
+  std::vector<Fr> ss_inverse(n);
   std::array<parallel::VoidTask, 2> tasks;
-  tasks[0] = [&last_g, &g1, &ss]() {
-    last_g = MultiExpBdlo12(&g1[0], &ss[0], g1.size());
+  tasks[0] = [&ss, &x, &x_inv, &proof]() {
+    BuildChallengeTensor(x, x_inv, ss.data(), ss.size());
+    for (auto& i : ss) i *= proof.a;
   };
-  tasks[1] = [&last_h, &g2, &ss_inverse]() {
-    last_h = MultiExpBdlo12(&g2[0], &ss_inverse[0], g2.size());
+  tasks[1] = [&ss_inverse, &x, &x_inv, &proof]() {
+    BuildChallengeTensor(x_inv, x, ss_inverse.data(), ss_inverse.size());
+    for (auto& i : ss_inverse) i *= proof.b;
   };
   parallel::Invoke(tasks);
 
-  G1 out = MultiExp(last_g, proof.a, last_h, proof.b);
-
-  out += u * (proof.a * proof.b);
-
-  if (rounds) {
-    auto get_g = [&proof](size_t i) -> G1 const& {
-      auto size = proof.left.size();
-      return i < size ? proof.left[i] : proof.right[i - size];
-    };
-    auto get_f = [&rounds_x](size_t i) -> Fr const& {
-      auto size = rounds_x.size();
-      return i < size ? rounds_x[i].square : rounds_x[i - size].square_inv;
-    };
-    p += MultiExpBdlo12<G1>(get_g, get_f, rounds * 2);
+  // g1*(a*ss) + g2*(b*ss_inverse) - L*x^2 - R*x^-2 + u*ab == p
+  std::vector<Fr> lr_f(rounds * 2);
+  for (size_t i = 0; i < rounds; ++i) {
+    lr_f[i] = -rounds_x[i].square;
+    lr_f[rounds + i] = -rounds_x[i].square_inv;
   }
+  auto get_g = [&g1, &g2, &proof, n, rounds](size_t i) -> G1 const& {
+    if (i < n) return g1[i];
+    i -= n;
+    if (i < n) return g2[i];
+    i -= n;
+    return i < rounds ? proof.left[i] : proof.right[i - rounds];
+  };
+  auto get_f = [&ss, &ss_inverse, &lr_f, n](size_t i) -> Fr const& {
+    if (i < n) return ss[i];
+    i -= n;
+    if (i < n) return ss_inverse[i];
+    return lr_f[i - n];
+  };
+  G1 out = MultiExpBdlo12<G1>(get_g, get_f, n * 2 + rounds * 2);
+  out += u * (proof.a * proof.b);
 
   bool ret = out == p;
   assert(ret);
@@ -2,6 +2,7 @@
 
 #include <cryptopp/keccak.h>
 
+#include <array>
 #include <vector>
 
 #include "ecc/ecc.h"
@@ -50,4 +51,34 @@ inline Fr Mimc5Enc(Fr const& plain, Fr const& key) {
   }
   return enc + key;
 }
+
+// Mimc5Enc of n plains with the same key. key + const of every round is
+// computed once, and kLanes independent lanes are interleaved round by round
+// so that the field muls of the different lanes overlap in the pipeline.
+inline void Mimc5EncBatch(Fr const* plain, Fr* out, int64_t n,
+                          Fr const& key) {
+  auto const& kMimc5Const = Mimc5Const();
+  std::array<Fr, kMimc5Round> key_const;
+  for (int64_t i = 0; i < kMimc5Round; ++i) {
+    key_const[i] = key + kMimc5Const[i];
+  }
+
+  constexpr int64_t kLanes = 8;
+  std::array<Fr, kLanes> enc;
+  std::array<Fr, kLanes> t;
+  for (int64_t begin = 0; begin < n; begin += kLanes) {
+    auto lanes = std::min(kLanes, n - begin);
+    for (int64_t j = 0; j < lanes; ++j) enc[j] = plain[begin + j];
+    for (int64_t i = 0; i < kMimc5Round; ++i) {
+      auto const& kc = key_const[i];
+      for (int64_t j = 0; j < lanes; ++j) {
+        Fr::add(t[j], enc[j], kc);
+        Fr::sqr(enc[j], t[j]);
+        Fr::sqr(enc[j], enc[j]);
+        enc[j] *= t[j];
+      }
+    }
+    for (int64_t j = 0; j < lanes; ++j) out[begin + j] = enc[j] + key;
+  }
+}
 }  // namespace circuit
@@ -41,6 +41,28 @@ class Mimc5Gadget : public libsnark::gadget<Fr> {
     generate_r1cs_witness();
   }
 
+  // the values of pb.full_variable_assignment() after Assign(plain, key),
+  // computed without a protoboard. out(i) is the slot of variable i.
+  template <typename Out>
+  static void GenerateWitness(Fr const& plain, Fr const& key, Out const& out) {
+    auto const& constants = Mimc5Const();
+    int64_t const r = (int64_t)constants.size();
+    out(0) = plain;
+    out(1) = key;
+    Fr data = plain;
+    for (int64_t i = 0; i < r; ++i) {
+      Fr x1 = data + key + constants[i];
+      Fr& x2 = out(2 + i);
+      Fr& x4 = out(2 + r + i);
+      Fr& x5 = out(2 + 2 * r + i);
+      Fr::sqr(x2, x1);
+      Fr::sqr(x4, x2);
+      Fr::mul(x5, x4, x1);
+      data = x5;
+    }
+    out(1 + 3 * r) += key;
+  }
+
  private:
   void generate_r1cs_constraints() {
     auto data = plain_;
@@ -78,9 +78,38 @@ const PoseidonConstants& poseidon_params() {
   return constants;
 }
 
+// the constant term of the partial rounds, C_i * M[i][j] summed over the
+// elements which skip the sbox, is the same for every input, so it is
+// computed once. ret[(r - partial_begin) * t + i] is the term of row i.
+template <unsigned param_t, unsigned param_c, unsigned param_F,
+          unsigned param_P>
+const std::vector<Fr>& poseidon_partial_terms() {
+  static std::vector<Fr> terms;
+  static std::once_flag flag;
+
+  std::call_once(flag, []() {
+    auto const& constants = poseidon_params<param_t, param_F, param_P>();
+    terms.resize(param_P * param_t);
+    for (unsigned r = 0; r < param_P; ++r) {
+      auto const& C_i = constants.C[param_F / 2 + r];
+      for (unsigned i = 0; i < param_t; ++i) {
+        Fr& lc = terms[r * param_t + i];
+        lc = FrZero();
+        for (unsigned j = param_c; j < param_t; j++) {
+          lc += C_i * constants.M[i * param_t + j];
+        }
+      }
+    }
+  });
+
+  return terms;
+}
+
+// const_terms: the precomputed constant terms of the rows, or nullptr
 template <unsigned param_t, unsigned nSBox, unsigned nInputs, unsigned nOutputs>
 std::array<Fr, nOutputs> PoseidonRound(const Fr& C_i, const std::vector<Fr>& M,
-                                       const std::array<Fr, nInputs>& state) {
+                                       const std::array<Fr, nInputs>& state,
+                                       Fr const* const_terms = nullptr) {
   static_assert(nInputs <= param_t, "nInputs <= param_t");
   static_assert(nOutputs <= param_t, "nInputs <= param_t");
 
@@ -90,9 +119,10 @@ std::array<Fr, nOutputs> PoseidonRound(const Fr& C_i, const std::vector<Fr>& M,
     if (h < nInputs) {
       value += state[h];
     }
-    // auto value2 = value * value;
-    // sbox[h] = value2 * value2 * value;
-    Fr::pow(sbox[h], value, 5);
+    Fr value2;
+    Fr::sqr(value2, value);
+    Fr::sqr(value2, value2);
+    Fr::mul(sbox[h], value2, value);
   }
 
   std::array<Fr, nOutputs> ret;
@@ -104,7 +134,9 @@ std::array<Fr, nOutputs> PoseidonRound(const Fr& C_i, const std::vector<Fr>& M,
     // Can be accumulated separately as part of the constant term
     Fr& lc = ret[i];
     lc = FrZero();
-    if (nSBox < param_t) {
+    if (const_terms) {
+      lc = const_terms[i];
+    } else if (nSBox < param_t) {
       for (unsigned j = nSBox; j < param_t; j++) {
         lc += C_i * M[M_offset + j];
       }
@@ -131,6 +163,8 @@ std::array<Fr, nOutputs> Poseidon(std::array<Fr, nInputs> const& inputs) {
   static constexpr unsigned total_rounds = param_F + param_P;
 
   auto const& constants = poseidon_params<param_t, param_F, param_P>();
+  auto const& partial_terms =
+      poseidon_partial_terms<param_t, param_c, param_F, param_P>();
 
   // first round
   auto first_round = PoseidonRound<param_t, param_t, nInputs, param_t>(
@@ -149,11 +183,13 @@ std::array<Fr, nOutputs> Poseidon(std::array<Fr, nInputs> const& inputs) {
 
   // partial_round
   auto partial_round = PoseidonRound<param_t, param_c, param_t, param_t>(
-      constants.C[partial_begin], constants.M, prefix_full_round);
+      constants.C[partial_begin], constants.M, prefix_full_round,
+      partial_terms.data());
 
   for (size_t i = partial_begin + 1; i < partial_end; ++i) {
     partial_round = PoseidonRound<param_t, param_c, param_t, param_t>(
-        constants.C[i], constants.M, partial_round);
+        constants.C[i], constants.M, partial_round,
+        partial_terms.data() + (i - partial_begin) * param_t);
   }
   // misc::PrintArray(partial_round);
 
@@ -487,8 +487,110 @@ class VrsPoseidon : public libsnark::gadget<Fr> {
     poseidon->generate_r1cs_witness();
   }
 
+  // the values of pb.full_variable_assignment() after Assign(plain, key),
+  // computed without a protoboard. out(i) is the slot of variable i. the
+  // layout is inputs, then x2, x4, x5 of every sbox round by round, then the
+  // output.
+  template <typename Out>
+  static void GenerateWitness(Fr const& plain, Fr const& key, Out const& out) {
+    constexpr unsigned t = 5, c = 1, F = 6, P = 52;
+    auto const& constants = poseidon_params<t, F, P>();
+    auto const& partial_terms = poseidon_partial_terms<t, c, F, P>();
+    auto const& M = constants.M;
+
+    int64_t k = 0;
+    out(k++) = plain;
+    out(k++) = key;
+    std::array<Fr, t> state{{plain, key}};
+    std::array<Fr, t> sbox;
+    unsigned n_inputs = 2;
+    for (unsigned r = 0; r < F + P; ++r) {
+      bool partial = r >= F / 2 && r < F / 2 + P;
+      unsigned n_sbox = partial ? c : t;
+      unsigned n_outputs = r + 1 == F + P ? 1 : t;
+      auto const& C_i = constants.C[r];
+      for (unsigned h = 0; h < n_sbox; ++h) {
+        Fr x = C_i;
+        if (h < n_inputs) x += state[h];
+        Fr& x2 = out(k++);
+        Fr& x4 = out(k++);
+        Fr& x5 = out(k++);
+        Fr::sqr(x2, x);
+        Fr::sqr(x4, x2);
+        Fr::mul(x5, x4, x);
+        sbox[h] = x5;
+      }
+
+      std::array<Fr, t> next;
+      for (unsigned i = 0; i < n_outputs; ++i) {
+        Fr& lc = next[i];
+        lc = partial ? partial_terms[(r - F / 2) * t + i] : FrZero();
+        for (unsigned j = 0; j < n_sbox; ++j) lc += sbox[j] * M[i * t + j];
+        for (unsigned j = n_sbox; j < n_inputs; ++j) {
+          lc += state[j] * M[i * t + j];
+        }
+      }
+      state = next;
+      n_inputs = t;
+    }
+    out(k++) = state[0];
+  }
+
   libsnark::pb_variable_array<Fr> inputs;
   std::unique_ptr<Base> poseidon;
 };
 
+// Poseidon<5, 1, 6, 52, 2, 1> against the gadget and against the rounds as
+// computed before poseidon_partial_terms: sbox by Fr::pow, the constant term
+// of the partial rounds summed per call.
+inline bool TestPoseidon() {
+  Tick tick(__FN__);
+  constexpr unsigned t = 5, c = 1, F = 6, P = 52;
+  auto const& constants = poseidon_params<t, F, P>();
+  auto const& M = constants.M;
+
+  auto reference = [&constants, &M](Fr const& plain, Fr const& key) {
+    std::array<Fr, t> state{{plain, key}};
+    unsigned n_inputs = 2;
+    for (unsigned r = 0; r < F + P; ++r) {
+      bool partial = r >= F / 2 && r < F / 2 + P;
+      unsigned n_sbox = partial ? c : t;
+      auto const& C_i = constants.C[r];
+      std::array<Fr, t> sbox;
+      for (unsigned h = 0; h < n_sbox; ++h) {
+        Fr x = C_i;
+        if (h < n_inputs) x += state[h];
+        Fr::pow(sbox[h], x, 5);
+      }
+      std::array<Fr, t> next;
+      for (unsigned i = 0; i < t; ++i) {
+        Fr& lc = next[i];
+        lc = FrZero();
+        for (unsigned j = n_sbox; j < t; ++j) lc += C_i * M[i * t + j];
+        for (unsigned j = 0; j < n_sbox; ++j) lc += sbox[j] * M[i * t + j];
+        for (unsigned j = n_sbox; j < n_inputs; ++j) {
+          lc += state[j] * M[i * t + j];
+        }
+      }
+      state = next;
+      n_inputs = t;
+    }
+    return state[0];
+  };
+
+  std::vector<std::array<Fr, 2>> inputs{
+      {{FrZero(), FrZero()}}, {{FrOne(), Fr(2)}}, {{FrRand(), FrRand()}}};
+  for (auto const& i : inputs) {
+    auto ret = Poseidon<t, c, F, P, 2, 1>(i)[0];
+    if (ret != reference(i[0], i[1])) {
+      std::cout << __FN__ << " reference mismatch\n";
+      return false;
+    }
+    if (ret != VrsPoseidon::permute(i[0], i[1])) {
+      std::cout << __FN__ << " gadget mismatch\n";
+      return false;
+    }
+  }
+  return true;
+}
 }  // namespace circuit
@@ -316,4 +316,22 @@ inline Fr Sha256Enc(Fr const& plain, Fr const& key) {
   for (auto& i : v) i = details::ReverseBits(i);
   return H256ToFr(v);
 }
+
+// Sha256Enc of n plains with the same key, the key block is prepared once
+inline void Sha256EncBatch(Fr const* plain, Fr* out, int64_t n,
+                           Fr const& key) {
+  uint8_t data[64];
+  h256_t k = FrToBin(key);
+  for (auto& i : k) i = details::ReverseBits(i);
+  memcpy(data + 32, k.data(), 32);
+
+  h256_t v;
+  for (int64_t j = 0; j < n; ++j) {
+    h256_t p = FrToBin(plain[j]);
+    for (size_t i = 0; i < p.size(); ++i) data[i] = details::ReverseBits(p[i]);
+    details::Sha256Compress(data, v.data());
+    for (auto& i : v) i = details::ReverseBits(i);
+    out[j] = H256ToFr(v);
+  }
+}
 }  // namespace circuit
\ No newline at end of file
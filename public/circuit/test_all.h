@@ -16,6 +16,7 @@ inline bool Test() {
   //fixed_point::Test(); 
   // cnn::Test();
   PermutationGadget::Test(9);
+  if (!TestPoseidon()) return false;
 
   return true;
 }
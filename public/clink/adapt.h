@@ -1,5 +1,8 @@
 #pragma once
 
+#include <map>
+#include <mutex>
+
 #include "hyrax/hyrax.h"
 
 // item:
@@ -83,174 +86,449 @@ inline h256_t AdaptItemDigest(std::vector<G1> const& cx,
   return digest;
 }
 
-template <typename Item>
-void AdaptUpdateSeed(h256_t& seed, std::vector<Item> const& items) {
-  std::vector<h256_t> digests(items.size());
-  auto parallel_f = [&digests, &items](int64_t i) {
-    digests[i] = AdaptItemDigest(items[i].cx, items[i].a, items[i].z);
-  };
-  parallel::For(items.size(), parallel_f);
+// the challenge of one item is drawn from the chain after it absorbed the
+// item (AdaptChainUpdate), so it binds every item folded before too and an
+// item can not be reground alone
+inline Fr AdaptItemChallenge(h256_t& chain) {
+  CryptoPP::Keccak_256 hash;
+  HashUpdate(hash, chain);
+  HashUpdate(hash, std::string("adapt item"));
+  hash.Final(chain.data());
+  return H256ToFr(chain);
+}
 
+// the key of an item in AdaptProof::order
+inline h256_t AdaptItemKey(std::string const& order_tag,
+                           h256_t const& digest) {
   CryptoPP::Keccak_256 hash;
-  HashUpdate(hash, seed);
-  for (auto const& i : digests) {
-    HashUpdate(hash, i);
-  }
-  hash.Final(seed.data());
+  h256_t key;
+  HashUpdate(hash, order_tag);
+  HashUpdate(hash, digest);
+  hash.Final(key.data());
+  return key;
 }
 
-inline void AdaptComputeFst(h256_t const& seed, std::vector<Fr>& e) {
-  std::string salt = "vgg16 adapt " + std::to_string(e.size());
-  ComputeFst(seed, salt, e);
+// the chain binds the seed and every vector folded so far
+inline void AdaptChainUpdate(h256_t& chain, h256_t const& key, uint64_t index,
+                             G1 const& cx) {
+  CryptoPP::Keccak_256 hash;
+  HashUpdate(hash, chain);
+  HashUpdate(hash, key);
+  HashUpdate(hash, index);
+  HashUpdate(hash, cx);
+  hash.Final(chain.data());
 }
 
-inline void AdaptProve(h256_t seed, std::vector<AdaptProveItem>&& items,
-                       hyrax::A4::Proof& proof) {
-  Tick tick(__FN__);
-  if (items.empty()) return;
+inline Fr AdaptFoldChallenge(h256_t& chain, G1 const& cl, G1 const& cu) {
+  CryptoPP::Keccak_256 hash;
+  HashUpdate(hash, chain);
+  HashUpdate(hash, cl);
+  HashUpdate(hash, cu);
+  hash.Final(chain.data());
+  return H256ToFr(chain);
+}
 
-  std::sort(items.begin(), items.end(),
-            [](AdaptProveItem const& a, AdaptProveItem const& b) {
-              return a.order_tag < b.order_tag;
-            });
+// the vectors of the items are folded into one in the order the prover got
+// them: x += e*x_i, a += a_i/e, so <x,a> gains <x_i,a_i> plus the cross terms
+// <x,a_i>/e + e*<x_i,a>, which are committed (cl, cu) before e is drawn. the
+// folded vector is proved by A3.
+// proof size: 32 bytes per item + 2 G1 per vector + A3
+struct AdaptProof {
+  std::vector<h256_t> order;  // AdaptItemKey of every item
+  std::vector<G1> cl;         // one per vector but the first
+  std::vector<G1> cu;
+  hyrax::A3::Proof proof_a3;
+
+  bool operator==(AdaptProof const& b) const {
+    return order == b.order && cl == b.cl && cu == b.cu &&
+           proof_a3 == b.proof_a3;
+  }
 
-#ifdef _DEBUG_CHECK
-  for (auto const& i : items) {
-    // std::cout << i.order_tag << "\n";
+  bool operator!=(AdaptProof const& b) const { return !(*this == b); }
 
-    if (!i.CheckFormat()) {
-      std::string errmsg = i.order_tag + " oops";
-      std::cout << errmsg << "\n";
-      throw std::runtime_error(errmsg);
-    }
-    if (!i.CheckData()) {
-      std::string errmsg = i.order_tag + " oops";
-      std::cout << errmsg << "\n";
-      throw std::runtime_error(errmsg);
+  template <typename Ar>
+  void serialize(Ar& ar) const {
+    ar& YAS_OBJECT_NVP("adapt.pf", ("o", order), ("cl", cl), ("cu", cu),
+                       ("r", proof_a3));
+  }
+  template <typename Ar>
+  void serialize(Ar& ar) {
+    ar& YAS_OBJECT_NVP("adapt.pf", ("o", order), ("cl", cl), ("cu", cu),
+                       ("r", proof_a3));
+  }
+};
+
+// streaming AdaptProve/AdaptVerify: the items come in any order, the chain
+// absorbs every item as it arrives and the item is scaled by the challenge
+// drawn from the chain, then the prover folds its vectors into the running
+// (x, a, cx) at once and drops them, the peak memory is one item plus the
+// accumulator. the verifier keeps its items (a, cx) and replays the chain at
+// the end in the order of the proof. Add is thread safe.
+template <typename Item>
+class AdaptAcc {
+ public:
+  explicit AdaptAcc(h256_t const& seed) : seed_(seed) {}
+
+ protected:
+  // the key of the item, false if the item is malformed
+  bool Prepare(Item const& item, h256_t& key) {
+    if (!item.CheckFormat()) {
+      std::cout << item.order_tag << " format error\n";
+      std::lock_guard<std::mutex> lock(mutex_);
+      bad_ = true;
+      return false;
     }
+    auto digest = AdaptItemDigest(item.cx, item.a, item.z);
+    key = AdaptItemKey(item.order_tag, digest);
+    return true;
   }
-#endif
 
-  //for (auto const& i : items) {
-  //  std::cout << __FN__ << " " << i.order_tag << "," << i.a.size() << "*"
-  //            << i.a[0].size() << "\n";
-  //}
+  // absorbs the item into the chain and draws its challenge
+  static Fr Absorb(h256_t& chain, h256_t const& key,
+                   std::vector<G1> const& cx) {
+    for (size_t i = 0; i < cx.size(); ++i) {
+      AdaptChainUpdate(chain, key, i, cx[i]);
+    }
+    return AdaptItemChallenge(chain);
+  }
 
-  AdaptUpdateSeed(seed, items);
+  // a += a_i * e_inv, a is padded with zero
+  static void FoldA(std::vector<Fr>& a, std::vector<Fr> const& a_i,
+                    Fr const& e_inv) {
+    if (a.size() < a_i.size()) a.resize(a_i.size(), FrZero());
+    auto pf = [&a, &a_i, &e_inv](int64_t j) { a[j] += a_i[j] * e_inv; };
+    parallel::For((int64_t)a_i.size(), pf, a_i.size() < 16 * 1024);
+  }
 
-  std::vector<Fr> e(items.size());
-  AdaptComputeFst(seed, e);
-  //std::cout << __FN__ << "  " << e[0] << "\n";
+  h256_t const seed_;
+  std::mutex mutex_;
+  bool bad_ = false;
+};
 
-  auto pf = [&items, &e](int64_t i) {
-    for (auto& j : items[i].a) {
-      j *= e[i];
+class AdaptProveAcc : public AdaptAcc<AdaptProveItem> {
+ public:
+  explicit AdaptProveAcc(h256_t const& seed)
+      : AdaptAcc(seed), chain_(seed) {}
+
+  void Add(AdaptProveItem&& item) {
+    h256_t key;
+    if (!Prepare(item, key)) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    order_.push_back(key);
+    Fr e = Absorb(chain_, key, item.cx);
+    auto pf = [&item, &e](int64_t i) { item.a[i] *= e; };
+    parallel::For(item.a.size(), pf);
+    z_ += item.z * e;
+    for (size_t i = 0; i < item.x.size(); ++i) {
+      Fold(std::move(item.x[i]), item.a[i], item.cx[i], item.rx[i]);
+      std::vector<Fr>().swap(item.a[i]);
     }
-    items[i].z *= e[i];
-    assert(items[i].CheckData());
-  };
-  parallel::For(items.size(), pf);
-
-  // combine
-  size_t vector_count = 0;
-  for (auto const& i : items) {
-    vector_count += i.x.size();
   }
 
-  std::vector<std::vector<Fr>> combined_x(vector_count);
-  std::vector<std::vector<Fr>> combined_a(vector_count);
-  std::vector<G1> combined_cx(vector_count);
-  std::vector<Fr> combined_rx(vector_count);
-  Fr combined_z = FrZero();
+  bool empty() const { return order_.empty(); }
 
-  size_t cursor = 0;
-  for (auto& item : items) {
-    for (size_t i = 0; i < item.x.size(); ++i) {
-      combined_x[cursor] = std::move(item.x[i]);
-      combined_a[cursor] = std::move(item.a[i]);
-      combined_cx[cursor] = std::move(item.cx[i]);
-      combined_rx[cursor] = std::move(item.rx[i]);
-      ++cursor;
+  void Prove(AdaptProof& proof) {
+    Tick tick(__FN__, std::to_string(x_.size()));
+    CHECK(!bad_, "");
+    proof = AdaptProof();
+    if (empty()) return;
+
+    // <x,a> = z_ + cross_, cz = com(z, t_)
+    Fr z = z_ + cross_;
+    G1 cz = pc::PcU() * z_ + c_cross_;
+#ifdef _DEBUG_CHECK
+    CHECK(InnerProduct(x_, a_) == z, "");
+    CHECK(cx_ == pc::ComputeCom(x_, r_), "");
+    CHECK(cz == pc::ComputeCom(pc::PcU(), z, t_), "");
+#endif
+
+    hyrax::A3::ProveInput input("adapt", x_, a_, z, pc::kGetRefG1, pc::PcU());
+    hyrax::A3::CommitmentPub com_pub(cx_, cz);
+    hyrax::A3::CommitmentSec com_sec(r_, t_);
+    hyrax::A3::Prove(proof.proof_a3, chain_, input, com_pub, com_sec);
+    proof.order = std::move(order_);
+    proof.cl = std::move(cl_);
+    proof.cu = std::move(cu_);
+  }
+
+ private:
+  void Fold(std::vector<Fr>&& x, std::vector<Fr> const& a, G1 const& cx,
+            Fr const& r) {
+    if (!folded_) {
+      folded_ = true;
+      x_ = std::move(x);
+      a_ = a;
+      cx_ = cx;
+      r_ = r;
+      return;
     }
-    combined_z += item.z;
+
+    Fr alpha = InnerProduct(x_, a);
+    Fr beta = InnerProduct(x, a_);
+    Fr tl = FrRand();
+    Fr tu = FrRand();
+    G1 cl = pc::ComputeCom(pc::PcU(), alpha, tl);
+    G1 cu = pc::ComputeCom(pc::PcU(), beta, tu);
+    Fr e = AdaptFoldChallenge(chain_, cl, cu);
+    Fr e_inv = FrInv(e);
+
+    if (x_.size() < x.size()) x_.resize(x.size(), FrZero());
+    auto pf = [this, &x, &e](int64_t j) { x_[j] += x[j] * e; };
+    parallel::For((int64_t)x.size(), pf, x.size() < 16 * 1024);
+    FoldA(a_, a, e_inv);
+    cx_ += cx * e;
+    r_ += r * e;
+
+    cross_ += alpha * e_inv + beta * e;
+    c_cross_ += cl * e_inv + cu * e;
+    t_ += tl * e_inv + tu * e;
+    cl_.push_back(cl);
+    cu_.push_back(cu);
   }
-  //std::cout << "prove combined_z: " << combined_z << "\n";
 
-  hyrax::A4::ProveInput input("adapt", std::move(combined_x), std::move(combined_a),
-                              combined_z, pc::kGetRefG1, pc::PcU());
-  hyrax::A4::CommitmentPub com_pub;
-  com_pub.cx = std::move(combined_cx);
-  com_pub.cz = pc::PcU() * combined_z;  // com_pub.cz = G1Zero();
+  h256_t chain_;
+  bool folded_ = false;
+  Fr z_ = FrZero();  // sum of the scaled z of the items
+  std::vector<Fr> x_;
+  std::vector<Fr> a_;
+  G1 cx_;
+  Fr r_;
+  Fr cross_ = FrZero();  // the folded cross terms, cl/cu, their randoms
+  G1 c_cross_ = G1Zero();
+  Fr t_ = FrZero();
+  std::vector<h256_t> order_;
+  std::vector<G1> cl_;
+  std::vector<G1> cu_;
+};
 
-  hyrax::A4::CommitmentSec com_sec;
-  com_sec.r = std::move(combined_rx);
-  com_sec.t = FrZero();
+class AdaptVerifyAcc : public AdaptAcc<AdaptVerifyItem> {
+ public:
+  explicit AdaptVerifyAcc(h256_t const& seed) : AdaptAcc(seed) {}
+
+  void Add(AdaptVerifyItem&& item) {
+    h256_t key;
+    if (!Prepare(item, key)) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    items_.emplace(key, std::move(item));
+  }
 
-  hyrax::A4::Prove(proof, seed, std::move(input), std::move(com_pub),
-                   std::move(com_sec));
+  bool empty() const { return items_.empty(); }
+
+  bool Verify(AdaptProof const& proof) {
+    Tick tick(__FN__, std::to_string(items_.size()));
+    if (bad_) return false;
+    if (proof.order.size() != items_.size()) return false;
+    if (proof.cl.size() != proof.cu.size()) return false;
+    if (empty()) return proof.cl.empty();
+
+    // cx = sum(cx_i * e_i), cz = u*z + sum(cl/e + cu*e)
+    h256_t chain = seed_;
+    Fr z = FrZero();
+    std::vector<Fr> a;
+    std::vector<G1> cx_bases;
+    std::vector<Fr> cx_coefs;
+    std::vector<G1> cz_bases;
+    std::vector<Fr> cz_coefs;
+    size_t round = 0;
+    for (auto const& key : proof.order) {
+      auto found = items_.find(key);
+      if (found == items_.end()) return false;
+      auto const& item = found->second;
+      Fr e_item = Absorb(chain, key, item.cx);
+      z += item.z * e_item;
+      for (size_t i = 0; i < item.a.size(); ++i) {
+        cx_bases.push_back(item.cx[i]);
+        if (cx_bases.size() == 1) {
+          a = item.a[i] * e_item;
+          cx_coefs.push_back(FrOne());
+          continue;
+        }
+        if (round == proof.cl.size()) return false;
+        auto const& cl = proof.cl[round];
+        auto const& cu = proof.cu[round];
+        ++round;
+        Fr e = AdaptFoldChallenge(chain, cl, cu);
+        Fr e_inv = FrInv(e);
+        FoldA(a, item.a[i], e_item * e_inv);
+        cx_coefs.push_back(e);
+        cz_bases.push_back(cl);
+        cz_coefs.push_back(e_inv);
+        cz_bases.push_back(cu);
+        cz_coefs.push_back(e);
+      }
+      items_.erase(found);
+    }
+    if (round != proof.cl.size() || a.empty()) return false;
+
+    G1 cx = MultiExpBdlo12(cx_bases, cx_coefs);
+    G1 cz = pc::PcU() * z + MultiExpBdlo12(cz_bases, cz_coefs);
+    hyrax::A3::CommitmentPub com_pub(cx, cz);
+    hyrax::A3::VerifyInput input("adapt", a, com_pub, pc::kGetRefG1,
+                                 pc::PcU());
+    bool success = hyrax::A3::Verify(proof.proof_a3, chain, input);
+    std::cout << __FILE__ << " " << __FN__ << ": " << success << "\n\n\n\n\n\n";
+    return success;
+  }
+
+ private:
+  std::multimap<h256_t, AdaptVerifyItem> items_;
+};
+
+inline void AdaptProve(h256_t seed, std::vector<AdaptProveItem>&& items,
+                       AdaptProof& proof) {
+  Tick tick(__FN__);
+  AdaptProveAcc acc(seed);
+  for (auto& i : items) acc.Add(std::move(i));
+  std::vector<AdaptProveItem>().swap(items);
+  acc.Prove(proof);
 }
 
 inline bool AdaptVerify(h256_t seed, std::vector<AdaptVerifyItem>&& items,
-                        hyrax::A4::Proof const& proof) {
+                        AdaptProof const& proof) {
   Tick tick(__FN__);
+  AdaptVerifyAcc acc(seed);
+  for (auto& i : items) acc.Add(std::move(i));
+  std::vector<AdaptVerifyItem>().swap(items);
+  return acc.Verify(proof);
+}
 
-  if (items.empty()) return true;
+// aggregate the adapt items of several independent statements (e.g. all the
+// proofs of one response) into one AdaptProof. every statement has its own
+// seed and a unique tag, the combined seed binds all of them, and the
+// order_tag of every item is prefixed by the tag of its statement so the items
+// of the different statements never mix.
+template <typename Item>
+struct AdaptStatement {
+  std::string tag;
+  h256_t seed;
+  std::vector<Item> items;
+};
 
-  std::sort(items.begin(), items.end(),
-            [](AdaptVerifyItem const& a, AdaptVerifyItem const& b) {
-              return a.order_tag < b.order_tag;
+using AdaptProveStatement = AdaptStatement<AdaptProveItem>;
+using AdaptVerifyStatement = AdaptStatement<AdaptVerifyItem>;
+
+template <typename Item>
+bool AdaptAggregate(std::vector<AdaptStatement<Item>>&& statements,
+                    h256_t& seed, std::vector<Item>& items) {
+  std::sort(statements.begin(), statements.end(),
+            [](AdaptStatement<Item> const& a, AdaptStatement<Item> const& b) {
+              return a.tag < b.tag;
             });
+  for (size_t i = 1; i < statements.size(); ++i) {
+    if (statements[i].tag == statements[i - 1].tag) {
+      std::cout << statements[i].tag << " duplicated statement\n";
+      return false;
+    }
+  }
 
-  for (auto const& i : items) {
-    if (!i.CheckFormat()) {
-      std::cout << i.order_tag << " format error\n";
-      throw std::runtime_error("oops");
+  CryptoPP::Keccak_256 hash;
+  HashUpdate(hash, std::string("adapt aggregate"));
+  HashUpdate(hash, (uint64_t)statements.size());
+  size_t count = 0;
+  for (auto const& i : statements) {
+    HashUpdate(hash, i.tag);
+    HashUpdate(hash, i.seed);
+    count += i.items.size();
+  }
+  hash.Final(seed.data());
+
+  items.clear();
+  items.reserve(count);
+  for (auto& i : statements) {
+    for (auto& item : i.items) {
+      item.order_tag = i.tag + "/" + item.order_tag;
+      items.push_back(std::move(item));
     }
   }
+  return true;
+}
 
-  AdaptUpdateSeed(seed, items);
+inline bool AdaptAggregateProve(std::vector<AdaptProveStatement>&& statements,
+                                AdaptProof& proof) {
+  Tick tick(__FN__, std::to_string(statements.size()));
+  h256_t seed;
+  std::vector<AdaptProveItem> items;
+  if (!AdaptAggregate(std::move(statements), seed, items)) return false;
+  AdaptProve(seed, std::move(items), proof);
+  return true;
+}
 
-  std::vector<Fr> e(items.size());
-  AdaptComputeFst(seed, e);
-  //std::cout << __FN__ << " " << e[0] << "\n";
+inline bool AdaptAggregateVerify(
+    std::vector<AdaptVerifyStatement>&& statements,
+    AdaptProof const& proof) {
+  Tick tick(__FN__, std::to_string(statements.size()));
+  h256_t seed;
+  std::vector<AdaptVerifyItem> items;
+  if (!AdaptAggregate(std::move(statements), seed, items)) return false;
+  return AdaptVerify(seed, std::move(items), proof);
+}
 
-  auto pf = [&items, &e](int64_t i) {
-    for (auto& j : items[i].a) {
-      j *= e[i];
+// three items of 1, 2, 3 random vectors, of size n, n/2, n/4
+inline void AdaptTestStatement(int64_t n, AdaptProveStatement& prove,
+                               AdaptVerifyStatement& verify) {
+  for (size_t k = 0; k < 3; ++k) {
+    auto tag = "item" + std::to_string(k);
+    AdaptProveItem item;
+    item.Init(k + 1, tag, FrZero());
+    for (size_t i = 0; i <= k; ++i) {
+      auto size = std::max<int64_t>(1, n >> i);
+      item.x[i].resize(size);
+      item.a[i].resize(size);
+      FrRand(item.x[i]);
+      FrRand(item.a[i]);
+      item.rx[i] = FrRand();
+      item.cx[i] = pc::ComputeCom(item.x[i], item.rx[i]);
+      item.z += InnerProduct(item.x[i], item.a[i]);
     }
-    items[i].z *= e[i];
-  };
-  parallel::For(items.size(), pf);
-
-  // combine
-  size_t vector_count = 0;
-  for (auto const& i : items) {
-    vector_count += i.a.size();
+    assert(item.CheckData());
+
+    AdaptVerifyItem verify_item;
+    verify_item.Init(k + 1, tag, item.z);
+    verify_item.a = item.a;
+    verify_item.cx = item.cx;
+    prove.items.push_back(std::move(item));
+    verify.items.push_back(std::move(verify_item));
+  }
+}
+
+// the statements share the item tags, a changed item and a duplicated
+// statement tag must fail
+inline bool TestAdaptAggregate(int64_t n) {
+  Tick tick(__FN__, std::to_string(n));
+  size_t const count = 3;
+  std::vector<AdaptProveStatement> prove_statements(count);
+  std::vector<AdaptVerifyStatement> verify_statements(count);
+  for (size_t i = 0; i < count; ++i) {
+    auto tag = "statement" + std::to_string(i);
+    auto seed = misc::RandH256();
+    prove_statements[i].tag = verify_statements[i].tag = tag;
+    prove_statements[i].seed = verify_statements[i].seed = seed;
+    AdaptTestStatement(n, prove_statements[i], verify_statements[i]);
   }
 
-  std::vector<std::vector<Fr>> combined_a(vector_count);
-  std::vector<G1> combined_cx(vector_count);
-  Fr combined_z = FrZero();
+  auto bad_verify_statements = verify_statements;
+  bad_verify_statements[count - 1].items[0].z += FrOne();
+  auto dup_prove_statements = prove_statements;
+  dup_prove_statements[1].tag = dup_prove_statements[0].tag;
+  auto dup_verify_statements = verify_statements;
+  dup_verify_statements[1].tag = dup_verify_statements[0].tag;
 
-  size_t cursor = 0;
-  for (auto& item : items) {
-    for (size_t i = 0; i < item.a.size(); ++i) {
-      combined_a[cursor] = std::move(item.a[i]);
-      combined_cx[cursor] = std::move(item.cx[i]);
-      ++cursor;
-    }
-    combined_z += item.z;
+  AdaptProof proof;
+  if (!AdaptAggregateProve(std::move(prove_statements), proof)) return false;
+  std::cout << "proof size: " << YasGetBinLen(proof) << "\n";
+
+  bool success = AdaptAggregateVerify(std::move(verify_statements), proof);
+  if (success) {
+    success = !AdaptAggregateVerify(std::move(bad_verify_statements), proof);
+  }
+  if (success) {
+    AdaptProof dup_proof;
+    success = !AdaptAggregateProve(std::move(dup_prove_statements), dup_proof);
+  }
+  if (success) {
+    success = !AdaptAggregateVerify(std::move(dup_verify_statements), proof);
   }
-  //std::cout << "verify combined_z: " << combined_z << "\n";
-
-  hyrax::A4::CommitmentPub com_pub;
-  com_pub.cx = std::move(combined_cx);
-  com_pub.cz = pc::PcU() * combined_z;  // com_pub.cz = G1Zero();
-  hyrax::A4::VerifyInput input("adapt", std::move(com_pub), pc::kGetRefG1,
-                               std::move(combined_a), pc::PcU());
-  bool success = hyrax::A4::Verify(proof, seed, input);
   std::cout << __FILE__ << " " << __FN__ << ": " << success << "\n\n\n\n\n\n";
   return success;
 }
-
 }  // namespace clink
@@ -0,0 +1,218 @@
+#pragma once
+
+#include "./batch_r1cs.h"
+#include "./pack.h"
+#include "./query_circuit_cache.h"
+
+// the batched form of MatchPack/SubstrPack over the n rows of a table.
+// x_i: row i, size = s, open com(gx, x_i)
+// y_i: y_i[j] = Gadget(key)(x_i[j]), {0,1}, the last variable of the gadget
+// pack_y_i = FrBitsToFrs(y_i), open com(gpy, pack_y_i)
+// the gadgets of all the rows are proved by one BatchR1cs proof. packing is
+// linear, so with e = fst(com(y_i), com(pack_y_i)) one Pack proof of
+// y = sum(e_i * y_i) and pack_y = sum(e_i * pack_y_i) proves every row.
+// only the proofs are batched: com_w still carries the s_var commitments of
+// every row, so the proof size is linear in n (n*s_var G1).
+
+namespace clink {
+
+template <typename Policy, typename Gadget>
+struct BatchQueryPack {
+  using HyraxA = typename Policy::HyraxA;
+  using R1cs = BatchR1cs<Policy>;
+  using BaseR1cs = ParallelR1cs<Policy>;
+
+  struct Proof {
+    // com_w[i]: row i, front: com(x_i), back: com(y_i), n*s_var G1
+    std::vector<std::vector<G1>> com_w;
+    std::vector<G1> com_pack_y;
+    typename R1cs::Proof r1cs_proof;
+    typename Pack<HyraxA>::Proof pack_proof;
+
+    bool operator==(Proof const& b) const {
+      return com_w == b.com_w && com_pack_y == b.com_pack_y &&
+             r1cs_proof == b.r1cs_proof && pack_proof == b.pack_proof;
+    }
+
+    bool operator!=(Proof const& b) const { return !(*this == b); }
+
+    template <typename Ar>
+    void serialize(Ar& ar) const {
+      ar& YAS_OBJECT_NVP("bqp.p", ("w", com_w), ("y", com_pack_y),
+                         ("r", r1cs_proof), ("p", pack_proof));
+    }
+    template <typename Ar>
+    void serialize(Ar& ar) {
+      ar& YAS_OBJECT_NVP("bqp.p", ("w", com_w), ("y", com_pack_y),
+                         ("r", r1cs_proof), ("p", pack_proof));
+    }
+  };
+
+  struct ProveOutput {
+    Proof proof;
+    std::vector<std::vector<Fr>> pack_y;
+    std::vector<Fr> com_pack_y_r;
+  };
+
+  // get_x(i, j), get_com_x(i), get_com_x_r(i)
+  template <typename Key, typename GetX, typename GetComX, typename GetComXR>
+  static void Prove(ProveOutput& output, h256_t seed, Key const& key,
+                    int64_t n, int64_t s, GetX const& get_x,
+                    GetComX const& get_com_x, GetComXR const& get_com_x_r,
+                    GetRefG1 const& get_gx, GetRefG1 const& get_gpy) {
+    Tick tick(__FN__);
+    auto circuit = QueryCircuitCache<Gadget, Key>::Instance().Get(key);
+    auto const& r1cs_info = circuit->r1cs_info();
+    auto s_var = r1cs_info->num_variables;
+    auto& proof = output.proof;
+
+    // witness and com_w of every row
+    std::vector<std::vector<std::vector<Fr>>> w(n);
+    std::vector<std::vector<Fr>> com_w_r(n);
+    proof.com_w.resize(n);
+    proof.com_pack_y.resize(n);
+    output.pack_y.resize(n);
+    output.com_pack_y_r.resize(n);
+    auto pf = [&output, &proof, &w, &com_w_r, &circuit, &get_x, &get_com_x,
+               &get_com_x_r, &get_gx, &get_gpy, s, s_var](int64_t i) {
+      auto& wi = w[i];
+      auto get_xi = [&get_x, i](int64_t j) -> Fr const& { return get_x(i, j); };
+      circuit->Witness(s, get_xi, wi);
+
+      auto& com_wi = proof.com_w[i];
+      auto& com_wi_r = com_w_r[i];
+      com_wi.resize(s_var);
+      com_wi_r.resize(s_var);
+      com_wi.front() = get_com_x(i);
+      com_wi_r.front() = get_com_x_r(i);
+      for (int64_t k = 1; k < s_var; ++k) {
+        com_wi_r[k] = FrRand();
+        com_wi[k] = pc::ComputeCom(get_gx, wi[k], com_wi_r[k], k == s_var - 1);
+      }
+
+      output.pack_y[i] = FrBitsToFrs(wi.back());
+      output.com_pack_y_r[i] = FrRand();
+      proof.com_pack_y[i] = pc::ComputeCom(get_gpy, output.pack_y[i],
+                                           output.com_pack_y_r[i]);
+    };
+    parallel::For(n, pf);
+
+    // fold the rows before the witness is moved to the r1cs
+    std::vector<Fr> e(n);
+    ComputeE(seed, proof.com_w, proof.com_pack_y, e);
+    auto pack_s = (s + 252) / 253;
+    std::vector<Fr> y(s, FrZero());
+    std::vector<Fr> pack_y(pack_s, FrZero());
+    Fr com_y_r = FrZero();
+    Fr com_pack_y_r = FrZero();
+    for (int64_t i = 0; i < n; ++i) {
+      auto const& yi = w[i].back();
+      for (int64_t j = 0; j < s; ++j) {
+        if (!yi[j].isZero()) y[j] += e[i];
+      }
+      for (int64_t j = 0; j < pack_s; ++j) {
+        pack_y[j] += e[i] * output.pack_y[i][j];
+      }
+      com_y_r += e[i] * com_w_r[i].back();
+      com_pack_y_r += e[i] * output.com_pack_y_r[i];
+    }
+    G1 com_y = FoldComY(proof.com_w, e);
+    G1 com_pack_y = MultiExpBdlo12(proof.com_pack_y, e);
+    // the y_i are binary (com_w is computed with check_01), the folded y is
+    // not, but packing is linear
+    assert(Pack<HyraxA>::PackLinear(y) == pack_y);
+
+    std::array<parallel::VoidTask, 2> tasks;
+    tasks[0] = [&proof, &w, &com_w_r, &r1cs_info, &get_gx, &seed, n]() {
+      std::vector<std::unique_ptr<typename BaseR1cs::ProveInput>> inputs(n);
+      auto pf2 = [&inputs, &proof, &w, &com_w_r, &r1cs_info,
+                  &get_gx](int64_t i) {
+        inputs[i].reset(new typename BaseR1cs::ProveInput(
+            *r1cs_info, Tag(i), std::move(w[i]), proof.com_w[i], com_w_r[i],
+            get_gx));
+      };
+      parallel::For(n, pf2);
+      std::vector<typename BaseR1cs::ProveInput*> pinputs(n);
+      for (int64_t i = 0; i < n; ++i) pinputs[i] = inputs[i].get();
+      R1cs::Prove(proof.r1cs_proof, seed, std::move(pinputs));
+    };
+    tasks[1] = [&proof, &y, &com_y, &com_y_r, &pack_y, &com_pack_y,
+                &com_pack_y_r, &get_gx, &get_gpy, &seed]() {
+      typename Pack<HyraxA>::ProveInput p_input(y, com_y, com_y_r, get_gx,
+                                                pack_y, com_pack_y,
+                                                com_pack_y_r, get_gpy);
+      Pack<HyraxA>::Prove(proof.pack_proof, seed, p_input);
+    };
+    parallel::Invoke(tasks);
+  }
+
+  // get_com_x(i)
+  template <typename Key, typename GetComX>
+  static bool Verify(Proof const& proof, h256_t seed, Key const& key,
+                     int64_t n, int64_t s, GetComX const& get_com_x,
+                     GetRefG1 const& get_gx, GetRefG1 const& get_gpy) {
+    Tick tick(__FN__);
+    auto r1cs_info =
+        QueryCircuitCache<Gadget, Key>::Instance().Get(key)->r1cs_info();
+    auto s_var = r1cs_info->num_variables;
+    if ((int64_t)proof.com_w.size() != n ||
+        (int64_t)proof.com_pack_y.size() != n) {
+      assert(false);
+      return false;
+    }
+    for (int64_t i = 0; i < n; ++i) {
+      auto const& com_wi = proof.com_w[i];
+      if ((int64_t)com_wi.size() != s_var || com_wi[0] != get_com_x(i)) {
+        assert(false);
+        return false;
+      }
+    }
+
+    std::vector<Fr> e(n);
+    ComputeE(seed, proof.com_w, proof.com_pack_y, e);
+
+    std::array<parallel::VoidTask, 2> tasks;
+    std::array<bool, 2> rets{false, false};
+    tasks[0] = [&proof, &seed, &rets, &r1cs_info, &get_gx, n, s]() {
+      std::vector<std::vector<Fr>> public_w;  // primary_input_size = 0
+      std::vector<std::unique_ptr<typename BaseR1cs::VerifyInput>> inputs(n);
+      std::vector<typename BaseR1cs::VerifyInput*> pinputs(n);
+      for (int64_t i = 0; i < n; ++i) {
+        inputs[i].reset(new typename BaseR1cs::VerifyInput(
+            s, *r1cs_info, Tag(i), proof.com_w[i], public_w, get_gx));
+        pinputs[i] = inputs[i].get();
+      }
+      rets[0] = R1cs::Verify(proof.r1cs_proof, seed, std::move(pinputs));
+    };
+    tasks[1] = [&proof, &seed, &rets, &e, &get_gx, &get_gpy, s]() {
+      G1 com_y = FoldComY(proof.com_w, e);
+      G1 com_pack_y = MultiExpBdlo12(proof.com_pack_y, e);
+      typename Pack<HyraxA>::VerifyInput p_input(s, com_y, get_gx, com_pack_y,
+                                                 get_gpy);
+      rets[1] = Pack<HyraxA>::Verify(proof.pack_proof, seed, p_input);
+    };
+    parallel::Invoke(tasks);
+    return rets[0] && rets[1];
+  }
+
+ private:
+  static std::string Tag(int64_t i) { return "bqp:" + std::to_string(i); }
+
+  static void ComputeE(h256_t seed, std::vector<std::vector<G1>> const& com_w,
+                       std::vector<G1> const& com_pack_y, std::vector<Fr>& e) {
+    CryptoPP::Keccak_256 hash;
+    HashUpdate(hash, seed);
+    for (auto const& i : com_w) HashUpdate(hash, i.back());
+    HashUpdate(hash, com_pack_y);
+    hash.Final(seed.data());
+    ComputeFst(seed, "bqp:e", e);
+  }
+
+  static G1 FoldComY(std::vector<std::vector<G1>> const& com_w,
+                     std::vector<Fr> const& e) {
+    auto get_g = [&com_w](int64_t i) -> G1 const& { return com_w[i].back(); };
+    return MultiExpBdlo12<G1>(get_g, e, e.size());
+  }
+};
+
+}  // namespace clink
@@ -24,18 +24,21 @@ struct BatchR1cs {
   using ProveInput = typename BaseR1cs::ProveInput;
   using VerifyInput = typename BaseR1cs::VerifyInput;
 
+  // binds the circuits and the com_w of all the inputs, prover and verifier
+  // see the same sorted inputs
+  template <typename Input>
   static void UpdateSeed(h256_t& seed,
-                         std::vector<ProveInput*> const& sorted_inputs) {
-    // TODO
-    (void)seed;
-    (void)sorted_inputs;
-  }
-
-  static void UpdateSeed(h256_t& seed,
-                         std::vector<VerifyInput*> const& sorted_inputs) {
-    // TODO
-    (void)seed;
-    (void)sorted_inputs;
+                         std::vector<Input*> const& sorted_inputs) {
+    CryptoPP::Keccak_256 hash;
+    HashUpdate(hash, seed);
+    HashUpdate(hash, (uint64_t)sorted_inputs.size());
+    for (auto const& i : sorted_inputs) {
+      HashUpdate(hash, i->unique_tag);
+      HashUpdate(hash, (uint64_t)i->m);
+      HashUpdate(hash, (uint64_t)i->n);
+      HashUpdate(hash, i->com_w);
+    }
+    hash.Final(seed.data());
   }
 
   // w: s*n
@@ -65,7 +68,7 @@ struct BatchR1cs {
       auto& com_pub = com_pubs[i];
       auto& com_sec = com_secs[i];
       BaseR1cs::BuildHpCom(input.m, input.n, input.com_w, input.com_w_r,
-                           input.constraints(), input.get_g, com_pub, com_sec);
+                           input.r1cs_info.csr, input.get_g, com_pub, com_sec);
     };
     parallel::For(inputs.size(), pf);
 
@@ -73,9 +76,10 @@ struct BatchR1cs {
     for (auto const& input : inputs) {
       combined_m += input->m;
     }
-    std::vector<std::vector<Fr>> combined_x(combined_m);
-    std::vector<std::vector<Fr>> combined_y(combined_m);
-    std::vector<std::vector<Fr>> combined_z(combined_m);
+    // the rows are appended as views, the arenas of the inputs move along
+    misc::Matrix<Fr> combined_x;
+    misc::Matrix<Fr> combined_y;
+    misc::Matrix<Fr> combined_z;
     std::vector<G1> combined_a(combined_m);
     std::vector<G1> combined_b(combined_m);
     std::vector<G1> combined_c(combined_m);
@@ -88,10 +92,10 @@ struct BatchR1cs {
       auto& input = *inputs[i];
       auto& com_pub = com_pubs[i];
       auto& com_sec = com_secs[i];
+      combined_x.Append(std::move(input.x));
+      combined_y.Append(std::move(input.y));
+      combined_z.Append(std::move(input.z));
       for (size_t j = 0; j < (size_t)input.m; ++j) {
-        combined_x[cursor] = std::move(input.x[j]);
-        combined_y[cursor] = std::move(input.y[j]);
-        combined_z[cursor] = std::move(input.z[j]);
         combined_a[cursor] = com_pub.a[j];
         combined_b[cursor] = com_pub.b[j];
         combined_c[cursor] = com_pub.c[j];
@@ -123,6 +127,7 @@ struct BatchR1cs {
   static bool Verify(Proof const& proof, h256_t seed,
                      std::vector<VerifyInput*>&& inputs) {
     Tick tick(__FN__);
+    if (inputs.empty()) return false;
 
     for (auto const& input : inputs) {
       CHECK(input->Check(), input->unique_tag);
@@ -138,14 +143,13 @@ struct BatchR1cs {
     });
 
     UpdateSeed(seed, inputs);
-    std::cout << __FN__ << " " << misc::HexToStr(seed) << "\n";
     std::vector<typename Sec43::CommitmentPub> com_pubs(inputs.size());
 
     auto pf = [&inputs, &com_pubs](int64_t i) {
       auto const& input = *inputs[i];
       auto& com_pub = com_pubs[i];
-      BaseR1cs::BuildHpCom(input.m, input.n, input.com_w, input.constraints(),
-                           input.get_g, com_pub);
+      BaseR1cs::BuildHpCom(input.m, input.n, input.com_w,
+                           input.r1cs_info.csr, input.get_g, com_pub);
     };
     parallel::For(inputs.size(), pf);
 
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <mutex>
+
+#include "./details.h"
+#include "./parallel_r1cs.h"
+
+// process wide registry of the compiled circuits. a circuit is built (the
+// protoboard, the constraint system and the csr) only once per key, and all
+// the users share the same R1csInfo. the key must name the circuit and all
+// of its parameters, such as "vrs.sha256c".
+// with a cache dir the constraint system is also saved there, and the later
+// processes load it instead of building the gadget (the csr is compiled again
+// from the loaded constraint system, it is much cheaper than the gadget).
+// the file carries a format version and the digest of the constraint system,
+// and the caller can check the loaded circuit against the current code (for
+// example with a native witness), a stale or broken file is rebuilt.
+namespace clink {
+
+class CircuitRegistry : boost::noncopyable {
+ public:
+  static CircuitRegistry& Instance() {
+    static CircuitRegistry instance;
+    return instance;
+  }
+
+  // empty: not persisted
+  void set_cache_dir(std::string const& dir) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cache_dir_ = dir;
+  }
+
+  // false if the loaded circuit does not match the current gadget
+  using Check = std::function<bool(R1csInfo const&)>;
+
+  // build(pb) generates the constraints of the circuit on pb and sets the
+  // input sizes. only the first caller of a key builds, the others wait.
+  template <typename Build>
+  std::shared_ptr<R1csInfo const> Get(std::string const& key,
+                                      Build const& build,
+                                      Check const& check = nullptr) {
+    std::shared_ptr<Entry> entry;
+    std::string cache_dir;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto& i = entries_[key];
+      if (!i) i.reset(new Entry);
+      entry = i;
+      cache_dir = cache_dir_;
+    }
+
+    std::call_once(entry->once, [&key, &build, &check, &entry, &cache_dir]() {
+      entry->r1cs_info = Load(cache_dir, key);
+      if (entry->r1cs_info) {
+        if (!check || check(*entry->r1cs_info)) return;
+        std::cerr << "stale circuit cache: " << FileName(cache_dir, key)
+                  << "\n";
+      }
+      Tick tick(__FN__, key);
+      libsnark::protoboard<Fr> pb;
+      build(pb);
+      entry->r1cs_info = std::make_shared<R1csInfo>(pb);
+      assert(!check || check(*entry->r1cs_info));
+      Save(cache_dir, key, entry->r1cs_info->constraint_system);
+    });
+    return entry->r1cs_info;
+  }
+
+ private:
+  CircuitRegistry() {}
+
+  struct Entry {
+    std::once_flag once;
+    std::shared_ptr<R1csInfo const> r1cs_info;
+  };
+
+  // the constraint system in the yas format, the linear combinations are
+  // flattened: lc_size[3*i+k] is the term count of a/b/c of constraint i.
+  // bump kVersion when the layout changes.
+  struct R1csFile {
+    enum : int64_t { kVersion = 2 };
+    int64_t version = kVersion;
+    h256_t digest;  // of all the other fields
+    std::string key;
+    int64_t primary_input_size = 0;
+    int64_t auxiliary_input_size = 0;
+    std::vector<int64_t> lc_size;
+    std::vector<int64_t> index;
+    std::vector<Fr> coeff;
+
+    h256_t ComputeDigest() const {
+      h256_t ret;
+      CryptoPP::Keccak_256 hash;
+      HashUpdate(hash, (uint64_t)version);
+      HashUpdate(hash, key);
+      HashUpdate(hash, (uint64_t)primary_input_size);
+      HashUpdate(hash, (uint64_t)auxiliary_input_size);
+      HashUpdate(hash, (uint64_t)lc_size.size());
+      HashUpdate(hash, lc_size.data(), lc_size.size() * sizeof(int64_t));
+      HashUpdate(hash, (uint64_t)index.size());
+      HashUpdate(hash, index.data(), index.size() * sizeof(int64_t));
+      HashUpdate(hash, coeff);
+      hash.Final(ret.data());
+      return ret;
+    }
+
+    bool operator==(R1csFile const& b) const {
+      return version == b.version && digest == b.digest && key == b.key &&
+             primary_input_size == b.primary_input_size &&
+             auxiliary_input_size == b.auxiliary_input_size &&
+             lc_size == b.lc_size && index == b.index && coeff == b.coeff;
+    }
+
+    template <typename Ar>
+    void serialize(Ar& ar) const {
+      ar& YAS_OBJECT_NVP("circuit.r1cs", ("v", version), ("d", digest),
+                         ("k", key), ("p", primary_input_size),
+                         ("a", auxiliary_input_size), ("l", lc_size),
+                         ("i", index), ("c", coeff));
+    }
+    template <typename Ar>
+    void serialize(Ar& ar) {
+      ar& YAS_OBJECT_NVP("circuit.r1cs", ("v", version), ("d", digest),
+                         ("k", key), ("p", primary_input_size),
+                         ("a", auxiliary_input_size), ("l", lc_size),
+                         ("i", index), ("c", coeff));
+    }
+  };
+
+  using ConstraintSystem = libsnark::r1cs_constraint_system<Fr>;
+  using LinearCombination = libsnark::linear_combination<Fr>;
+
+  static std::string FileName(std::string const& cache_dir,
+                              std::string const& key) {
+    return cache_dir + "/" + key + ".r1cs";
+  }
+
+  static void Save(std::string const& cache_dir, std::string const& key,
+                   ConstraintSystem const& cs) {
+    if (cache_dir.empty()) return;
+    R1csFile file;
+    file.key = key;
+    file.primary_input_size = cs.primary_input_size;
+    file.auxiliary_input_size = cs.auxiliary_input_size;
+    file.lc_size.reserve(cs.constraints.size() * 3);
+    for (auto const& c : cs.constraints) {
+      for (auto lc : {&c.a, &c.b, &c.c}) {
+        file.lc_size.push_back((int64_t)lc->terms.size());
+        for (auto const& t : lc->terms) {
+          file.index.push_back((int64_t)t.index);
+          file.coeff.push_back(t.coeff);
+        }
+      }
+    }
+    file.digest = file.ComputeDigest();
+
+    boost::system::error_code ec;
+    fs::create_directories(cache_dir, ec);
+    // write then rename, the other processes never see a partial file
+    auto path = FileName(cache_dir, key);
+    auto tmp = fs::unique_path(path + ".%%%%-%%%%").string();
+    if (!YasSaveBin(tmp, file)) return;
+    fs::rename(tmp, path, ec);
+    if (ec) fs::remove(tmp, ec);
+  }
+
+  static std::shared_ptr<R1csInfo const> Load(std::string const& cache_dir,
+                                              std::string const& key) {
+    if (cache_dir.empty()) return nullptr;
+    auto path = FileName(cache_dir, key);
+    boost::system::error_code ec;
+    if (!fs::is_regular_file(path, ec)) return nullptr;
+
+    Tick tick(__FN__, key);
+    R1csFile file;
+    if (!YasLoadBin(path, file) || file.version != R1csFile::kVersion ||
+        file.digest != file.ComputeDigest() || file.key != key ||
+        file.lc_size.size() % 3 || file.index.size() != file.coeff.size()) {
+      std::cerr << "invalid circuit cache: " << path << "\n";
+      return nullptr;
+    }
+
+    ConstraintSystem cs;
+    cs.primary_input_size = (size_t)file.primary_input_size;
+    cs.auxiliary_input_size = (size_t)file.auxiliary_input_size;
+    cs.constraints.resize(file.lc_size.size() / 3);
+    size_t pos = 0;
+    for (size_t i = 0; i < file.lc_size.size(); ++i) {
+      auto& c = cs.constraints[i / 3];
+      LinearCombination* lcs[] = {&c.a, &c.b, &c.c};
+      auto& lc = *lcs[i % 3];
+      auto size = (size_t)file.lc_size[i];
+      if (pos + size > file.index.size()) return nullptr;
+      lc.terms.reserve(size);
+      for (size_t j = pos; j < pos + size; ++j) {
+        lc.terms.emplace_back(libsnark::variable<Fr>(file.index[j]),
+                              file.coeff[j]);
+      }
+      pos += size;
+    }
+    if (pos != file.index.size() || !cs.is_valid()) {
+      std::cerr << "invalid circuit cache: " << path << "\n";
+      return nullptr;
+    }
+    return std::make_shared<R1csInfo>(std::move(cs));
+  }
+
+  std::mutex mutex_;
+  std::string cache_dir_;
+  std::map<std::string, std::shared_ptr<Entry>> entries_;
+};
+}  // namespace clink
@@ -1,7 +1,9 @@
 #pragma once
 
 // some pedersen commitment utils
+#include "./batch_query_pack.h"
 #include "./batch_r1cs.h"
+#include "./circuit_registry.h"
 #include "./divide.h"
 #include "./equal_ip.h"
 #include "./equality.h"
@@ -20,4 +22,5 @@
 #include "./sudoku.h"
 #include "./vgg16/vgg16.h"
 #include "./vrs/vrs_basic.h"
+#include "./vrs/vrs_cache_producer.h"
 #include "./vrs/vrs_large.h"
\ No newline at end of file
@@ -135,34 +135,34 @@ struct EqualIp {
 
   static bool Verify(h256_t const& seed, Proof const& proof,
                      VerifyInput const& input) {
-    std::array<std::atomic<bool>, 2> rets;
-    std::array<parallel::VoidTask, 2> tasks;
-    tasks[0] = [&proof, &input, &rets, &seed]() {
-      typename HyraxA::CommitmentPub com_pub;
-      com_pub.xi = input.com_x;
-      com_pub.tau = proof.com_z;
-      typename HyraxA::VerifyInput a_input("eip", input.a, com_pub,
-                                           input.get_gx, input.gz);
-      rets[0] = HyraxA::Verify(proof.p1, seed, a_input);
-    };
-    tasks[1] = [&proof, &input, &rets, &seed]() {
-      typename HyraxA::CommitmentPub com_pub;
-      com_pub.xi = input.com_y;
-      com_pub.tau = proof.com_z;
-      typename HyraxA::VerifyInput a_input("eip", input.b, com_pub,
-                                           input.get_gy, input.gz);
-      rets[1] = HyraxA::Verify(proof.p2, seed, a_input);
-    };
-
-    parallel::Invoke(tasks);
-
-    if (!rets[0] || !rets[1]) {
+    // both proofs share the generators, check them in one multiexp
+    MultiExpAcc acc;
+    if (!Verify(seed, proof, input, acc) || !acc.Check()) {
       assert(false);
       return false;
     }
     return true;
   }
 
+  // defers the multiexp checks of both proofs to acc
+  static bool Verify(h256_t const& seed, Proof const& proof,
+                     VerifyInput const& input, MultiExpAcc& acc) {
+    typename HyraxA::CommitmentPub com_pub1;
+    com_pub1.xi = input.com_x;
+    com_pub1.tau = proof.com_z;
+    typename HyraxA::VerifyInput a_input("eip", input.a, com_pub1,
+                                         input.get_gx, input.gz);
+
+    typename HyraxA::CommitmentPub com_pub2;
+    com_pub2.xi = input.com_y;
+    com_pub2.tau = proof.com_z;
+    typename HyraxA::VerifyInput b_input("eip", input.b, com_pub2,
+                                         input.get_gy, input.gz);
+
+    return HyraxA::Verify(proof.p1, seed, a_input, acc) &&
+           HyraxA::Verify(proof.p2, seed, b_input, acc);
+  }
+
   static bool Test(int64_t xn, int64_t yn);
 };
 
@@ -30,17 +30,9 @@ struct Pack {
           com_y(com_y),
           com_y_r(com_y_r),
           get_gy(get_gy) {
-#ifdef _DEBUG
+      // y must be PackLinear(x), x need not be binary, the callers check
+      // their input (MatchPack, SubstrPack, BatchQueryPack)
       assert((xn() + 252) / 253 == yn());
-      assert(FrBitsToFrs(x) == y);
-      auto check_x = FrsToFrBits(y);
-      assert(check_x.size() >= x.size());
-      for (auto i = x.size(); i < check_x.size(); ++i) {
-        assert(check_x[i] == 0);
-      }
-      check_x.resize(x.size());
-      assert(check_x == x);
-#endif
     }
     int64_t xn() const { return (int64_t)x.size(); }
     int64_t yn() const { return (int64_t)y.size(); }
@@ -110,6 +102,13 @@ struct Pack {
   // NOET: n is x.size()
   static bool Verify(Proof const& proof, h256_t seed,
                      VerifyInput const& input) {
+    MultiExpAcc acc;
+    return Verify(proof, seed, input, acc) && acc.Check();
+  }
+
+  // defers the multiexp checks to acc
+  static bool Verify(Proof const& proof, h256_t seed, VerifyInput const& input,
+                     MultiExpAcc& acc) {
     int64_t xn = input.xn;
     int64_t yn = input.yn;
 
@@ -137,11 +136,21 @@ struct Pack {
 
     typename EqualIp<HyraxA>::VerifyInput eip_input(
         a, input.com_x, input.get_gx, b, input.com_y, input.get_gy);
-    return EqualIp<HyraxA>::Verify(seed, proof, eip_input);
+    return EqualIp<HyraxA>::Verify(seed, proof, eip_input, acc);
   }
 
   static bool Test(int64_t xn);
 
+  // y[i] = sum(x[253*i+j] * 2^j), same as FrBitsToFrs for the binary x
+  static std::vector<Fr> PackLinear(std::vector<Fr> const& x) {
+    std::vector<Fr> y((x.size() + 252) / 253, FrZero());
+    for (size_t i = 0; i < y.size(); ++i) {
+      auto end = std::min(x.size(), i * 253 + 253);
+      for (size_t j = end; j > i * 253; --j) y[i] = y[i] + y[i] + x[j - 1];
+    }
+    return y;
+  }
+
  private:
   static void UpdateSeed(h256_t& seed, G1 const& c1, G1 const& c2, int64_t n) {
     CryptoPP::Keccak_256 hash;
@@ -3,6 +3,7 @@
 #include <libsnark/gadgetlib1/protoboard.hpp>
 
 #include "./details.h"
+#include "./r1cs_csr.h"
 #include "circuit/test_gadget.h"
 #include "groth09/groth09.h"
 
@@ -19,10 +20,17 @@ struct R1csInfo {
   R1csInfo(libsnark::protoboard<Fr> const &pb)
       : num_constraints(pb.num_constraints()),
         num_variables(pb.num_variables()),
-        constraint_system(pb.get_constraint_system()) {}
+        constraint_system(pb.get_constraint_system()),
+        csr(constraint_system) {}
+  explicit R1csInfo(libsnark::r1cs_constraint_system<Fr> &&cs)
+      : num_constraints(cs.num_constraints()),
+        num_variables(cs.num_variables()),
+        constraint_system(std::move(cs)),
+        csr(constraint_system) {}
   int64_t num_constraints;
   int64_t num_variables;
   libsnark::r1cs_constraint_system<Fr> constraint_system;
+  R1csCsr csr;
   std::string to_string() const {
     return "R1csInfo: num_constraints: " + std::to_string(num_constraints) +
            ", num_variables: " + std::to_string(num_variables);
@@ -47,7 +55,10 @@ struct ParallelR1cs {
           get_g(get_g),
           m(r1cs_info.num_constraints),
           s(r1cs_info.num_variables),
-          n((int64_t)w[0].size()) {
+          n((int64_t)w[0].size()),
+          x(m, n),
+          y(m, n),
+          z(m, n) {
       CHECK((int64_t)w.size() == s, "");
       CHECK((int64_t)com_w.size() == s, "");
       CHECK((int64_t)com_w_r.size() == s, "");
@@ -61,29 +72,17 @@ struct ParallelR1cs {
       }
 #endif
 
-      x.resize(m);
-      for (auto &i : x) i.resize(n);
+      // written in place, Sec43b takes the matrices without a copy
+      r1cs_info.csr.Evaluate(w, x, y, z);
 
-      y.resize(m);
-      for (auto &i : y) i.resize(n);
-
-      z.resize(m);
-      for (auto &i : z) i.resize(n);
-
-      auto parallel_f = [this, &w](int64_t j) {
-        std::vector<Fr> witness(s);
-        for (int64_t i = 0; i < s; ++i) {
-          witness[i] = w[i][j];
-        }
-        for (int64_t i = 0; i < m; ++i) {
-          auto const &constraint = constraints()[i];
-          x[i][j] = constraint.a.evaluate(witness);
-          y[i][j] = constraint.b.evaluate(witness);
-          z[i][j] = constraint.c.evaluate(witness);
+#ifdef _DEBUG
+      auto parallel_f = [this](int64_t i) {
+        for (int64_t j = 0; j < n; ++j) {
           assert(z[i][j] == x[i][j] * y[i][j]);
         }
       };
-      parallel::For(n, parallel_f);
+      parallel::For(m, parallel_f);
+#endif
     }
 
     libsnark::r1cs_constraint_system<Fr> const &constraint_system() const {
@@ -102,9 +101,9 @@ struct ParallelR1cs {
     int64_t const m;
     int64_t const s;
     int64_t const n;
-    std::vector<std::vector<Fr>> x;
-    std::vector<std::vector<Fr>> y;
-    std::vector<std::vector<Fr>> z;
+    misc::Matrix<Fr> x;
+    misc::Matrix<Fr> y;
+    misc::Matrix<Fr> z;
   };
 
   // w: s*n
@@ -122,7 +121,7 @@ struct ParallelR1cs {
 
     typename Sec43::CommitmentPub com_pub;
     typename Sec43::CommitmentSec com_sec;
-    BuildHpCom(m, n, input.com_w, input.com_w_r, input.constraints(),
+    BuildHpCom(m, n, input.com_w, input.com_w_r, input.r1cs_info.csr,
                input.get_g, com_pub, com_sec);
     DebugCheckHpCom(m, input_43, com_pub, com_sec);
 
@@ -153,6 +152,21 @@ struct ParallelR1cs {
     }
 
     bool Check() const {
+      if (!CheckSize()) return false;
+
+      bool all_success = false;
+      auto parallel_f = [this](int64_t i) {
+        return com_w[i] == pc::ComputeCom(get_g, public_w[i], FrZero());
+      };
+      parallel::For(&all_success, (int64_t)public_w.size(), parallel_f);
+      if (!all_success) {
+        std::cerr << __FN__ << ":" << __LINE__ << " oops\n";
+        return false;
+      }
+      return true;
+    }
+
+    bool CheckSize() const {
       if ((int64_t)com_w.size() != s) {
         assert(false);
         std::cerr << __FN__ << ":" << __LINE__ << " oops\n";
@@ -175,16 +189,6 @@ struct ParallelR1cs {
         std::cerr << __FN__ << ":" << __LINE__ << " oops\n";
         return false;
       }
-
-      bool all_success = false;
-      auto parallel_f = [this](int64_t i) {
-        return com_w[i] == pc::ComputeCom(get_g, public_w[i], FrZero());
-      };
-      parallel::For(&all_success, (int64_t)public_w.size(), parallel_f);
-      if (!all_success) {
-        std::cerr << __FN__ << ":" << __LINE__ << " oops\n";
-        return false;
-      }
       return true;
     }
 
@@ -210,7 +214,7 @@ struct ParallelR1cs {
     UpdateSeed(seed, input.com_w);
 
     typename Sec43::CommitmentPub com_pub;
-    BuildHpCom(input.m, input.n, input.com_w, input.constraints(), input.get_g,
+    BuildHpCom(input.m, input.n, input.com_w, input.r1cs_info.csr, input.get_g,
                com_pub);
 
     std::vector<size_t> mn(input.m, input.n);
@@ -219,45 +223,78 @@ struct ParallelR1cs {
     return Sec43::Verify(proof, seed, input_43);
   }
 
+  // defers the opening check of public_w and the multiexp checks of Sec43 to
+  // acc, returns false only if the proof is malformed.
+  static bool Verify(Proof const &proof, h256_t seed, VerifyInput const &input,
+                     MultiExpAcc &acc) {
+    if (!input.CheckSize()) return false;
+
+    // w*(com(get_g, public_w[i], 0) - com_w[i]) = 0
+    for (size_t i = 0; i < input.public_w.size(); ++i) {
+      Fr w = FrRand();
+      std::vector<Fr> wp = input.public_w[i] * w;
+      acc.Add(input.get_g, wp.data(), input.n);
+      acc.AddCopy(input.com_w[i], -w);
+    }
+
+    UpdateSeed(seed, input.com_w);
+
+    typename Sec43::CommitmentPub com_pub;
+    BuildHpCom(input.m, input.n, input.com_w, input.r1cs_info.csr, input.get_g,
+               com_pub);
+
+    std::vector<size_t> mn(input.m, input.n);
+    typename Sec43::VerifyInput input_43(mn, com_pub, input.get_g, input.get_g,
+                                         input.get_g);
+    return Sec43::Verify(proof, seed, input_43, acc);
+  }
+
+  struct BatchVerifyItem {
+    BatchVerifyItem(Proof const &proof, h256_t const &seed,
+                    VerifyInput const &input)
+        : proof(proof), seed(seed), input(input) {}
+    Proof const &proof;
+    h256_t const seed;
+    VerifyInput const &input;
+  };
+
+  // e.g. one proof per row of a query, BuildHpCom and the folding of every
+  // proof run in parallel, then all the final checks are done by one multiexp.
+  // if failed and bad is not null, verify the proofs one by one and set *bad
+  // to the index of the first bad proof.
+  static bool BatchVerify(std::vector<BatchVerifyItem> const &items,
+                          int64_t *bad = nullptr) {
+    Tick tick(__FN__, std::to_string(items.size()));
+    if (bad) *bad = -1;
+    auto f = [&items](int64_t i, MultiExpAcc &acc) {
+      auto const &item = items[i];
+      return Verify(item.proof, item.seed, item.input, acc);
+    };
+    bool ret = BatchVerifyDeferred((int64_t)items.size(), f);
+    if (!ret && bad) *bad = FindBad(items);
+    return ret;
+  }
+
  public:
   // for prove
-  static void BuildHpCom(
-      int64_t m, int64_t n, std::vector<G1> const &com_w,
-      std::vector<Fr> const &com_w_r,
-      std::vector<libsnark::r1cs_constraint<Fr>> const &constraints,
-      GetRefG1 const &get_g, typename Sec43::CommitmentPub &com_pub,
-      typename Sec43::CommitmentSec &com_sec) {
-    com_pub.a.resize(m);
-    G1Zero(com_pub.a);
-    com_pub.b.resize(m);
-    G1Zero(com_pub.b);
-    com_pub.c.resize(m);
-    G1Zero(com_pub.c);
-    com_sec.r.resize(m);
-    FrZero(com_sec.r);
-    com_sec.s.resize(m);
-    FrZero(com_sec.s);
-    com_sec.t.resize(m);
-    FrZero(com_sec.t);
-
+  // com_pub.a = A*com_w + A.constant*sigma_g, com_sec.r = A*com_w_r, and so
+  // on for b,s and c,t
+  static void BuildHpCom(int64_t m, int64_t n, std::vector<G1> const &com_w,
+                         std::vector<Fr> const &com_w_r, R1csCsr const &csr,
+                         GetRefG1 const &get_g,
+                         typename Sec43::CommitmentPub &com_pub,
+                         typename Sec43::CommitmentSec &com_sec) {
+    Tick tick(__FN__);
+    CHECK(csr.m() == m, "");
     auto pds_sigma_g = pc::ComputeSigmaG(get_g, n);
-    auto parallel_f = [&com_pub, &com_sec, &com_w, &com_w_r, &pds_sigma_g,
-                       &constraints](int64_t i) {
-      auto &com_pub_a = com_pub.a[i];
-      auto &com_pub_b = com_pub.b[i];
-      auto &com_pub_c = com_pub.c[i];
-      auto &com_sec_r = com_sec.r[i];
-      auto &com_sec_s = com_sec.s[i];
-      auto &com_sec_t = com_sec.t[i];
-      auto const &constraint = constraints[i];
-      BuildHpCom(com_w, com_w_r, constraint.a, com_pub_a, com_sec_r,
-                 pds_sigma_g);
-      BuildHpCom(com_w, com_w_r, constraint.b, com_pub_b, com_sec_s,
-                 pds_sigma_g);
-      BuildHpCom(com_w, com_w_r, constraint.c, com_pub_c, com_sec_t,
-                 pds_sigma_g);
-    };
-    parallel::For(m, parallel_f);
+    std::array<parallel::VoidTask, 6> tasks;
+    tasks[0] = [&]() { R1csCsr::MulVec(csr.a, com_w, pds_sigma_g, com_pub.a); };
+    tasks[1] = [&]() { R1csCsr::MulVec(csr.b, com_w, pds_sigma_g, com_pub.b); };
+    tasks[2] = [&]() { R1csCsr::MulVec(csr.c, com_w, pds_sigma_g, com_pub.c); };
+    tasks[3] = [&]() { R1csCsr::MulVec(csr.a, com_w_r, FrZero(), com_sec.r); };
+    tasks[4] = [&]() { R1csCsr::MulVec(csr.b, com_w_r, FrZero(), com_sec.s); };
+    tasks[5] = [&]() { R1csCsr::MulVec(csr.c, com_w_r, FrZero(), com_sec.t); };
+    parallel::Invoke(tasks);
   }
 
   static void DebugCheckHpCom(int64_t m,
@@ -275,15 +312,18 @@ struct ParallelR1cs {
       auto &com_sec_t = com_sec.t[i];
 
       auto const &xi = input.x[i];
-      G1 check_com_pub_a = pc::ComputeCom(input.get_gx, xi, com_sec_r);
+      G1 check_com_pub_a =
+          pc::ComputeCom(xi.size(), input.get_gx, xi.data(), com_sec_r);
       assert(check_com_pub_a == com_pub_a);
 
       auto const &yi = input.y[i];
-      G1 check_com_pub_b = pc::ComputeCom(input.get_gy, yi, com_sec_s);
+      G1 check_com_pub_b =
+          pc::ComputeCom(yi.size(), input.get_gy, yi.data(), com_sec_s);
       assert(check_com_pub_b == com_pub_b);
 
       auto const &zi = input.z[i];
-      G1 check_com_pub_c = pc::ComputeCom(input.get_gz, zi, com_sec_t);
+      G1 check_com_pub_c =
+          pc::ComputeCom(zi.size(), input.get_gz, zi.data(), com_sec_t);
       assert(check_com_pub_c == com_pub_c);
     }
 #else
@@ -295,81 +335,20 @@ struct ParallelR1cs {
   }
 
   // for verify
-  static void BuildHpCom(
-      int64_t m, int64_t n, std::vector<G1> const &com_w,
-      std::vector<libsnark::r1cs_constraint<Fr>> const &constraints,
-      GetRefG1 const &get_g, typename Sec43::CommitmentPub &com_pub) {
-    com_pub.a.resize(m);
-    G1Zero(com_pub.a);
-    com_pub.b.resize(m);
-    G1Zero(com_pub.b);
-    com_pub.c.resize(m);
-    G1Zero(com_pub.c);
-
+  static void BuildHpCom(int64_t m, int64_t n, std::vector<G1> const &com_w,
+                         R1csCsr const &csr, GetRefG1 const &get_g,
+                         typename Sec43::CommitmentPub &com_pub) {
+    Tick tick(__FN__);
+    CHECK(csr.m() == m, "");
     auto pds_sigma_g = pc::ComputeSigmaG(get_g, n);
-    auto parallel_f = [&com_pub, &com_w, &pds_sigma_g,
-                       &constraints](int64_t i) {
-      auto &com_pub_a = com_pub.a[i];
-      auto &com_pub_b = com_pub.b[i];
-      auto &com_pub_c = com_pub.c[i];
-      auto const &constraint = constraints[i];
-      BuildHpCom(com_w, constraint.a, com_pub_a, pds_sigma_g);
-      BuildHpCom(com_w, constraint.b, com_pub_b, pds_sigma_g);
-      BuildHpCom(com_w, constraint.c, com_pub_c, pds_sigma_g);
-    };
-    parallel::For(m, parallel_f);
+    std::array<parallel::VoidTask, 3> tasks;
+    tasks[0] = [&]() { R1csCsr::MulVec(csr.a, com_w, pds_sigma_g, com_pub.a); };
+    tasks[1] = [&]() { R1csCsr::MulVec(csr.b, com_w, pds_sigma_g, com_pub.b); };
+    tasks[2] = [&]() { R1csCsr::MulVec(csr.c, com_w, pds_sigma_g, com_pub.c); };
+    parallel::Invoke(tasks);
   }
 
  private:
-  // com(<A,X>) or com(<B,X>) or com(<C,X>)
-  static void BuildHpCom(std::vector<G1> const &com_w,
-                         std::vector<Fr> const &com_w_r,
-                         libsnark::linear_combination<Fr> const &lc,
-                         G1 &com_pub, Fr &com_sec, G1 const &sigma_g) {
-    // Tick tick(__FN__);
-    for (auto const &term : lc.terms) {
-      if (term.coeff == FrZero()) continue;
-      if (term.coeff == FrOne()) {
-        if (term.index == 0) {  // constants
-          com_pub += sigma_g;
-        } else {
-          com_pub += com_w[term.index - 1];
-          com_sec += com_w_r[term.index - 1];
-        }
-      } else {
-        if (term.index == 0) {  // constants
-          com_pub += sigma_g * term.coeff;
-        } else {
-          com_pub += com_w[term.index - 1] * term.coeff;
-          com_sec += com_w_r[term.index - 1] * term.coeff;
-        }
-      }
-    }
-  }
-
-  // com(<A,X>) or com(<B,X>) or com(<C,X>)
-  static void BuildHpCom(std::vector<G1> const &com_w,
-                         libsnark::linear_combination<Fr> const &lc,
-                         G1 &com_pub, G1 const &sigma_g) {
-    // Tick tick(__FN__);
-    for (auto const &term : lc.terms) {
-      if (term.coeff == FrZero()) continue;
-      if (term.coeff == FrOne()) {
-        if (term.index == 0) {  // constants
-          com_pub += sigma_g;
-        } else {
-          com_pub += com_w[term.index - 1];
-        }
-      } else {
-        if (term.index == 0) {  // constants
-          com_pub += sigma_g * term.coeff;
-        } else {
-          com_pub += com_w[term.index - 1] * term.coeff;
-        }
-      }
-    }
-  }
-
   static void UpdateSeed(h256_t &seed, std::vector<G1> const &com_w) {
     // update seed
     CryptoPP::Keccak_256 hash;
@@ -378,6 +357,18 @@ struct ParallelR1cs {
     hash.Final(seed.data());
   }
 
+  static int64_t FindBad(std::vector<BatchVerifyItem> const &items) {
+    std::vector<int64_t> rets(items.size());
+    auto pf = [&items, &rets](int64_t i) {
+      auto const &item = items[i];
+      MultiExpAcc acc;
+      rets[i] = Verify(item.proof, item.seed, item.input, acc) && acc.Check();
+    };
+    parallel::For((int64_t)items.size(), pf);
+    auto it = std::find(rets.begin(), rets.end(), 0);
+    return it == rets.end() ? -1 : (int64_t)(it - rets.begin());
+  }
+
  public:
   static bool Test(int64_t m, int64_t n) {
     libsnark::protoboard<Fr> pb;
@@ -429,7 +420,11 @@ struct ParallelR1cs {
     std::vector<std::vector<Fr>> public_w;
     VerifyInput verify_input(n, r1cs_info, "test", com_w, public_w,
                              pc::kGetRefG1);
-    return Verify(proof, seed, verify_input);
+    if (!Verify(proof, seed, verify_input)) return false;
+
+    Proof bad_proof = proof;
+    bad_proof.c += pc::PcH();
+    return TestBatchVerify<ParallelR1cs>(proof, bad_proof, seed, verify_input);
   }
 };
 
@@ -22,6 +22,8 @@ struct Pod {
   typedef std::function<Fr const&(int64_t i, int64_t j)> GetMatrix;
   typedef std::function<Fr const&(int64_t i)> GetR;
   typedef std::function<G1 const&(int64_t i)> GetCom;
+  // sink(i, m) gets the s decrypted elements of row i
+  typedef std::function<void(int64_t i, Fr const* m)> RowSink;
 
   static G1 const& kVwG() { return pc::PcU(); }
 
@@ -40,10 +42,12 @@ struct Pod {
     std::vector<Fr> vw;  // s + 1
     h256_t vrs_plain_seed;
     Fr vw_com_r;
+    int64_t vrs_unit_per_zkp = 0;  // the chunking of vrs_proofs
     std::vector<VrsProof> vrs_proofs;
     bool operator==(ProvedData const& b) const {
       return k == b.k && em == b.em && vw == b.vw &&
              vrs_plain_seed == b.vrs_plain_seed && vw_com_r == b.vw_com_r &&
+             vrs_unit_per_zkp == b.vrs_unit_per_zkp &&
              vrs_proofs == b.vrs_proofs;
     }
 
@@ -53,13 +57,13 @@ struct Pod {
     void serialize(Ar& ar) const {
       ar& YAS_OBJECT_NVP("pod.pd", ("k", k), ("em", em), ("vw", vw),
                          ("seed", vrs_plain_seed), ("r", vw_com_r),
-                         ("p", vrs_proofs));
+                         ("u", vrs_unit_per_zkp), ("p", vrs_proofs));
     }
     template <typename Ar>
     void serialize(Ar& ar) {
       ar& YAS_OBJECT_NVP("pod.pd", ("k", k), ("em", em), ("vw", vw),
                          ("seed", vrs_plain_seed), ("r", vw_com_r),
-                         ("p", vrs_proofs));
+                         ("u", vrs_unit_per_zkp), ("p", vrs_proofs));
     }
   };
 
@@ -99,35 +103,21 @@ struct Pod {
     auto n = commited_data.n;
     auto s = commited_data.s;
 
-    std::string cache_dir;
-    if (!data_dir.empty() && !debug::flags::disable_vrs_cache) {
-      cache_dir = data_dir + "/vrs_cache/" + Scheme::type();
-    }
-
-    output.cache.reset(new AutoCacheFile(cache_dir, (n + 1) * (s + 1)));
-    auto cache = output.cache->LoadAndUpgrade();
+    auto cache = InitSecret(output, n, s, data_dir);
+    auto w = Encrypt(output, seed, commited_data);
+    VrsProve(s, seed, w, output, cache.get());
+  }
 
-    std::vector<std::vector<G1>> cached_var_coms;
-    std::vector<std::vector<Fr>> cached_var_coms_r;
-    if (cache) {
-      output.proved_data.vrs_plain_seed = cache->seed;
-      output.secret.key = cache->key;
-      output.secret.key_com_r = cache->key_com_r;
-      cached_var_coms = std::move(cache->var_coms);
-      cached_var_coms_r = std::move(cache->var_coms_r);
-    } else {
-      output.proved_data.vrs_plain_seed = misc::RandH256();
-      output.secret.key = FrRand();
-      output.secret.key_com_r = FrRand();
-    }
+  // k, em and vw of EncryptAndProve for the secret and the vrs plain seed
+  // already in output, returns w
+  static std::vector<Fr> Encrypt(ProveOutput& output, h256_t& seed,
+                                 CommitedData const& commited_data) {
+    auto n = commited_data.n;
+    auto s = commited_data.s;
 
     // generate vrs plain by vrs_plain_seed
-    std::vector<Fr> plain((n + 1) * (s + 1));
-    auto parallel_f_p = [&plain, &output](uint64_t i) {
-      VrsPub<Scheme>::GeneratePlain(&plain[i],
-                                    output.proved_data.vrs_plain_seed, i);
-    };
-    parallel::For(plain.size(), parallel_f_p);
+    auto plain = VrsPub<Scheme>::GeneratePlainBatch(
+        output.proved_data.vrs_plain_seed, (n + 1) * (s + 1));
 
     auto v = GenerateV(plain, output.secret.key);
 
@@ -170,10 +160,146 @@ struct Pod {
       }
     };
     parallel::For(s + 1, parallel_f_vw);
+    return w;
+  }
+
+  // the same proof as EncryptAndProve, but the data is read from table_file
+  // and the rows are processed in blocks, so only one block of plain and v is
+  // in memory (plus the vrs chunks in flight). table_file holds the n*s m in
+  // the native Fr encoding, row major. the em is not kept in
+  // output.proved_data.em but written to em_file in the same encoding, n rows
+  // of s+1, LoadEm reads it back.
+  static bool EncryptAndProveFile(ProveOutput& output, h256_t seed, int64_t n,
+                                  int64_t s, std::string const& table_file,
+                                  GetR const& get_r,
+                                  std::string const& em_file,
+                                  std::string const& data_dir,
+                                  int64_t block_rows = 0) {
+    Tick _tick_(__FN__);
+    if (!n || !s || s > pc::Base::GSize()) return false;
+
+    io::mapped_file_source table;
+    try {
+      table.open(table_file);
+    } catch (std::exception& e) {
+      std::cerr << __FN__ << ": " << e.what() << "\n";
+      return false;
+    }
+    if ((int64_t)table.size() != n * s * (int64_t)sizeof(Fr)) {
+      std::cerr << __FN__ << ": invalid table size\n";
+      return false;
+    }
+
+    // created only after the table is checked, removed if it fails
+    io::mapped_file_sink em_sink;
+    try {
+      io::mapped_file_params params(em_file);
+      params.new_file_size = n * (s + 1) * sizeof(Fr);
+      em_sink.open(params);
+    } catch (std::exception& e) {
+      std::cerr << __FN__ << ": " << e.what() << "\n";
+      boost::system::error_code ec;
+      fs::remove(em_file, ec);
+      return false;
+    }
+    auto const* m = (Fr const*)table.data();
+    auto* em = (Fr*)em_sink.data();
+
+    if (block_rows <= 0) {
+      auto row_bytes = (s + 1) * (int64_t)sizeof(Fr);
+      block_rows = std::max<int64_t>(1, kStreamBlockBytes / row_bytes);
+    }
+
+    auto cache = InitSecret(output, n, s, data_dir);
+    auto const& plain_seed = output.proved_data.vrs_plain_seed;
+    auto const& key = output.secret.key;
+
+    // k and em, block by block. v of the last row (it has no em) is kept.
+    auto& k = output.proved_data.k;
+    k.resize(n + 1);
+    std::vector<Fr> last_v;
+    for (int64_t begin = 0; begin <= n; begin += block_rows) {
+      auto end = std::min(begin + block_rows, n + 1);
+      auto plain = VrsPub<Scheme>::GeneratePlainBatch(
+          plain_seed, (end - begin) * (s + 1), begin * (s + 1));
+      auto v = GenerateV(plain, key);
+      std::vector<Fr>().swap(plain);
+
+      auto parallel_f = [&k, &v, &get_r, m, em, begin, n, s](int64_t t) {
+        auto i = begin + t;
+        Fr const* vi0 = &v[t * (s + 1)];
+        k[i] = MultiExpBdlo12<G1>(pc::PcHG, vi0, s + 1);
+        k[i].normalize();
+        if (i == n) return;
+        Fr* emi0 = em + i * (s + 1);
+        emi0[0] = vi0[0] + get_r(i);
+        for (int64_t j = 0; j < s; ++j) {
+          emi0[j + 1] = vi0[j + 1] + m[i * s + j];
+        }
+      };
+      parallel::For(end - begin, parallel_f);
+
+      if (end == n + 1) last_v.assign(v.end() - (s + 1), v.end());
+    }
+
+    // w
+    UpdateSeed(seed, k);
+    std::vector<Fr> w(n + 1);
+    ComputeFst(seed, "pod", w);
+
+    // vw, v of the other rows is em - (r, m), cheaper than the vrs again
+    int64_t const kStripes = std::min<int64_t>(n, 256);
+    std::vector<std::vector<Fr>> stripe_vw(kStripes);
+    auto parallel_f_vw = [&stripe_vw, &w, &get_r, m, em, n, s,
+                          kStripes](int64_t t) {
+      auto& vw = stripe_vw[t];
+      vw.assign(s + 1, FrZero());
+      for (int64_t i = t; i < n; i += kStripes) {
+        Fr const* emi0 = em + i * (s + 1);
+        vw[0] += (emi0[0] - get_r(i)) * w[i];
+        for (int64_t j = 0; j < s; ++j) {
+          vw[j + 1] += (emi0[j + 1] - m[i * s + j]) * w[i];
+        }
+      }
+    };
+    parallel::For(kStripes, parallel_f_vw);
+
+    auto& vw = output.proved_data.vw;
+    vw.resize(s + 1);
+    for (int64_t j = 0; j <= s; ++j) {
+      vw[j] = last_v[j] * w[n];
+      for (auto const& i : stripe_vw) vw[j] += i[j];
+    }
+
+    try {
+      em_sink.close();
+    } catch (std::exception& e) {
+      std::cerr << __FN__ << ": " << e.what() << "\n";
+      boost::system::error_code ec;
+      fs::remove(em_file, ec);
+      return false;
+    }
 
     // vrs
-    VrsProve(s, seed, plain, w, output, std::move(cached_var_coms),
-             std::move(cached_var_coms_r));
+    VrsProve(s, seed, w, output, cache.get());
+    return true;
+  }
+
+  // the em written by EncryptAndProveFile
+  static bool LoadEm(std::string const& em_file, int64_t n, int64_t s,
+                     std::vector<Fr>& em) {
+    try {
+      io::mapped_file_source file(em_file);
+      if ((int64_t)file.size() != n * (s + 1) * (int64_t)sizeof(Fr)) {
+        return false;
+      }
+      em.resize(n * (s + 1));
+      memcpy(em.data(), file.data(), file.size());
+      return true;
+    } catch (std::exception& e) {
+      std::cerr << __FN__ << ": " << e.what() << "\n";
+      return false;
+    }
   }
 
   static bool VerifyAndSign(VerifyOutput& output, h256_t seed, int64_t n,
@@ -251,12 +377,7 @@ struct Pod {
                                    Fr const& key) {
     Tick _tick_(__FN__);
     // ex: v = mimc_enc(plain, key)
-    std::vector<Fr> v(plain.size());
-    auto parallel_f = [&v, &plain, &key](uint64_t i) {
-      v[i] = Scheme::Generate(plain[i], key);
-    };
-    parallel::For(v.size(), parallel_f);
-    return v;
+    return VrsPub<Scheme>::GenerateV(plain, key);
   }
 
   static bool DecryptData(int64_t n, int64_t s,
@@ -294,6 +415,73 @@ struct Pod {
     return true;
   }
 
+  // decrypts only the rows (any order, row < n) of encrypted_m (n rows of
+  // s+1), their v is generated from the vrs plain seed. the rows are
+  // decrypted in parallel block by block and given to sink in the order of
+  // rows, so the first rows arrive before the others are decrypted.
+  static bool DecryptRows(int64_t n, int64_t s, Fr const* encrypted_m,
+                          h256_t const& vrs_plain_seed, Secret const& secret,
+                          Receipt const& receipt,
+                          std::vector<int64_t> const& rows,
+                          RowSink const& sink, int64_t block_rows = 1024) {
+    Tick _tick_(__FN__);
+    if (!VerifySecret(receipt, secret)) {
+      assert(false);
+      return false;
+    }
+    for (auto i : rows) {
+      if (i < 0 || i >= n) return false;
+    }
+
+    block_rows = std::max<int64_t>(1, block_rows);
+    std::vector<Fr> block(block_rows * (s + 1));
+    for (size_t begin = 0; begin < rows.size(); begin += block_rows) {
+      auto count = std::min(rows.size() - begin, (size_t)block_rows);
+      auto parallel_f = [&block, &rows, &vrs_plain_seed, &secret, encrypted_m,
+                         begin, s](int64_t t) {
+        auto i = rows[begin + t];
+        Fr* v = &block[t * (s + 1)];
+        Fr plain[VrsPub<Scheme>::kBlockSize];
+        for (int64_t j = 0; j < s + 1; j += VrsPub<Scheme>::kBlockSize) {
+          auto size = std::min<int64_t>(VrsPub<Scheme>::kBlockSize, s + 1 - j);
+          auto ij = i * (s + 1) + j;
+          VrsPub<Scheme>::GeneratePlain(plain, vrs_plain_seed, ij, size);
+          Scheme::Generate(plain, v + j, size, secret.key);
+        }
+        // the decrypted m takes the place of v[1, s]
+        Fr const* emi0 = encrypted_m + i * (s + 1);
+        for (int64_t j = 1; j < s + 1; ++j) v[j] = emi0[j] - v[j];
+      };
+      parallel::For((int64_t)count, parallel_f);
+
+      for (size_t t = 0; t < count; ++t) {
+        sink(rows[begin + t], &block[t * (s + 1) + 1]);
+      }
+    }
+    return true;
+  }
+
+  // the rows of the ranges, in order
+  static bool DecryptRanges(int64_t n, int64_t s, Fr const* encrypted_m,
+                            h256_t const& vrs_plain_seed, Secret const& secret,
+                            Receipt const& receipt,
+                            std::vector<Range> const& ranges,
+                            RowSink const& sink) {
+    std::vector<int64_t> rows;
+    for (auto const& range : ranges) {
+      // start + count could wrap
+      if (range.count > (uint64_t)n ||
+          range.start > (uint64_t)n - range.count) {
+        return false;
+      }
+      for (uint64_t i = 0; i < range.count; ++i) {
+        rows.push_back((int64_t)(range.start + i));
+      }
+    }
+    return DecryptRows(n, s, encrypted_m, vrs_plain_seed, secret, receipt,
+                       rows, sink);
+  }
+
   static bool VerifySecret(Receipt const& receipt, Secret const& secret) {
     return VrsPub<Scheme>::VerifySecret(receipt.h, receipt.g, receipt.key_com,
                                         secret.key_com_r, secret.key);
@@ -302,6 +490,32 @@ struct Pod {
   static bool Test(int64_t n, int64_t s, std::string const& cache_dir);
 
  private:
+  // the size of a row block of EncryptAndProveFile
+  static int64_t constexpr kStreamBlockBytes = 64 * 1024 * 1024;
+
+  // the vrs plain seed and the secret, from a vrs cache if there is one
+  static std::unique_ptr<VrsCacheFile> InitSecret(
+      ProveOutput& output, int64_t n, int64_t s, std::string const& data_dir) {
+    std::string cache_dir;
+    if (!data_dir.empty() && !debug::flags::disable_vrs_cache) {
+      cache_dir = VrsCache<Scheme>::CacheDir(data_dir);
+    }
+
+    output.cache.reset(new AutoCacheFile(cache_dir, (n + 1) * (s + 1)));
+    auto cache = output.cache->LoadAndUpgrade();
+
+    if (cache) {
+      output.proved_data.vrs_plain_seed = cache->header().seed;
+      output.secret.key = cache->header().key;
+      output.secret.key_com_r = cache->header().key_com_r;
+    } else {
+      output.proved_data.vrs_plain_seed = misc::RandH256();
+      output.secret.key = FrRand();
+      output.secret.key_com_r = FrRand();
+    }
+    return cache;
+  }
+
   static void UpdateSeed(h256_t& seed, std::vector<G1> const& k) {
     // Tick tick(__FN__);
     CryptoPP::Keccak_256 hash;
@@ -325,23 +539,26 @@ struct Pod {
     return all_success;
   }
 
-  static void VrsProve(int64_t s, h256_t const& seed,
-                       std::vector<Fr> const& plain, std::vector<Fr> const& w,
-                       ProveOutput& output,
-                       std::vector<std::vector<G1>>&& cached_var_coms,
-                       std::vector<std::vector<Fr>>&& cached_var_coms_r) {
+  // the plain of every vrs chunk is generated from the vrs plain seed when
+  // the chunk is proved
+  static void VrsProve(int64_t s, h256_t const& seed, std::vector<Fr> const& w,
+                       ProveOutput& output, VrsCacheFile const* cache) {
     Tick tick(__FN__);
-    auto get_p = [&plain](int64_t i) -> Fr const& { return plain[i]; };
+    auto count = (int64_t)w.size() * (s + 1);
     auto get_w = [&w, s](int64_t i) -> Fr const& { return w[i / (s + 1)]; };
     output.proved_data.vw_com_r = FrRand();
-    VrsProveInput vrs_prove_input(plain.size(), output.secret.key,
-                                  output.secret.key_com_r, std::move(get_p),
+    VrsProveInput vrs_prove_input(count, output.secret.key,
+                                  output.secret.key_com_r, nullptr,
                                   std::move(get_w), output.proved_data.vw_com_r,
                                   kVwG());
+    // a cache fixes the chunking
+    auto plan = VrsPlanner<Scheme>::Plan(
+        count, cache ? cache->header().max_unit_per_zkp : 0);
+    output.proved_data.vrs_unit_per_zkp = plan.unit_per_zkp;
     VrsProveOutput vrs_output;
     Vrs::Prove(output.proved_data.vrs_proofs, vrs_output, seed,
-               std::move(vrs_prove_input), std::move(cached_var_coms),
-               std::move(cached_var_coms_r));
+               std::move(vrs_prove_input), cache, plan,
+               &output.proved_data.vrs_plain_seed);
 
     // generate wanted receipt
     output.receipt.h = vrs_output.h;
@@ -352,12 +569,8 @@ struct Pod {
   static bool VrsVerify(int64_t n, int64_t s, h256_t const& seed,
                         ProvedData const& proved_data, VerifyOutput& output,
                         VrsVerifyOutput& vrs_output) {
-    output.plain.resize((n + 1) * (s + 1));
-    auto parallel_f = [&output, &proved_data](int64_t i) {
-      VrsPub<Scheme>::GeneratePlain(&output.plain[i],
-                                    proved_data.vrs_plain_seed, i);
-    };
-    parallel::For((int64_t)output.plain.size(), parallel_f);
+    output.plain = VrsPub<Scheme>::GeneratePlainBatch(
+        proved_data.vrs_plain_seed, (n + 1) * (s + 1));
 
     auto get_p = [&output](int64_t i) -> Fr const& { return output.plain[i]; };
     auto get_w = [&output, s](int64_t i) -> Fr const& {
@@ -368,7 +581,7 @@ struct Pod {
                              std::move(get_w), kVwG());
 
     if (!Vrs::Verify(vrs_output, proved_data.vrs_proofs, seed,
-                     std::move(vrs_input))) {
+                     std::move(vrs_input), proved_data.vrs_unit_per_zkp)) {
       assert(false);
       return false;
     }
@@ -484,6 +697,75 @@ bool Pod<Scheme, Policy>::Test(int64_t n, int64_t s,
     return false;
   }
 
+  // or only some rows
+  std::vector<int64_t> rows{n - 1, 0};
+  bool rows_ok = true;
+  auto sink = [&m, &rows_ok, s](int64_t i, Fr const* mi) {
+    rows_ok = rows_ok && std::equal(mi, mi + s, m.begin() + i * s);
+  };
+  if (!DecryptRows(n, s, prove_output.proved_data.em.data(),
+                   prove_output.proved_data.vrs_plain_seed,
+                   prove_output.secret, verify_output.receipt, rows, sink) ||
+      !rows_ok) {
+    assert(false);
+    return false;
+  }
+
+  // the streaming path on the same data: m goes to a table file and the em
+  // comes back by LoadEm. k, vw and em must be those of EncryptAndProve for
+  // the secret it picked.
+  auto tmp = (fs::temp_directory_path() / fs::unique_path("pod.%%%%-%%%%"))
+                 .string();
+  auto table_file = tmp + ".table";
+  auto em_file = tmp + ".em";
+  {
+    std::ofstream os(table_file, std::ios::binary);
+    os.write((char const*)m.data(), m.size() * sizeof(Fr));
+  }
+  h256_t file_seed = misc::RandH256();
+  ProveOutput file_output;
+  bool file_ok = EncryptAndProveFile(file_output, file_seed, n, s, table_file,
+                                     get_r, em_file, data_dir, (n + 2) / 3) &&
+                 LoadEm(em_file, n, s, file_output.proved_data.em);
+  boost::system::error_code ec;
+  fs::remove(table_file, ec);
+  fs::remove(em_file, ec);
+  if (!file_ok) {
+    assert(false);
+    return false;
+  }
+
+  ProveOutput check_output;
+  check_output.proved_data.vrs_plain_seed =
+      file_output.proved_data.vrs_plain_seed;
+  check_output.secret = file_output.secret;
+  h256_t check_seed = file_seed;
+  Encrypt(check_output, check_seed, commited_data);
+  auto const& file_data = file_output.proved_data;
+  auto const& check_data = check_output.proved_data;
+  if (file_data.k != check_data.k || file_data.vw != check_data.vw ||
+      file_data.em != check_data.em) {
+    assert(false);
+    return false;
+  }
+
+  VerifyOutput file_verify_output;
+  if (!VerifyAndSign(file_verify_output, file_seed, n, s, get_com,
+                     file_data) ||
+      file_output.receipt != file_verify_output.receipt) {
+    assert(false);
+    return false;
+  }
+  if (file_output.cache) {
+    file_output.cache->SetLeaked();
+  }
+  if (!DecryptData(n, s, file_data.em, file_output.secret, file_verify_output,
+                   decrypted_m) ||
+      m != decrypted_m) {
+    assert(false);
+    return false;
+  }
+
   std::cout << "success\n";
   return true;
 }
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include "./details.h"
+#include "./parallel_r1cs.h"
+
+// lru cache of the compiled query circuits (match, substr), keyed by the
+// pattern. a circuit holds the constraint system and the csr (R1csInfo) and
+// a pool of protoboards to generate the witness, and is shared by all the
+// rows and the requests of the same pattern. unlike CircuitRegistry the
+// patterns come from the queries, so only the recent ones are kept; an
+// evicted circuit lives on while it is still used.
+namespace clink {
+
+inline std::string QueryCircuitKey(Fr const& k) { return k.getStr(16); }
+
+inline std::string QueryCircuitKey(std::string const& k) { return k; }
+
+template <typename Gadget, typename Key>
+class QueryCircuitCache : boost::noncopyable {
+ public:
+  class Circuit : boost::noncopyable {
+   public:
+    explicit Circuit(Key const& key) : key_(key) {
+      std::unique_ptr<Generator> generator(new Generator(key_));
+      r1cs_info_ = std::make_shared<R1csInfo>(generator->pb);
+      generators_.push_back(std::move(generator));
+    }
+
+    std::shared_ptr<R1csInfo const> const& r1cs_info() const {
+      return r1cs_info_;
+    }
+
+    int64_t num_variables() const { return r1cs_info_->num_variables; }
+
+    // w[k][j]: the variable k of get_x(j), size = num_variables() * n
+    template <typename GetX>
+    void Witness(int64_t n, GetX const& get_x,
+                 std::vector<std::vector<Fr>>& w) const {
+      auto s = num_variables();
+      w.resize(s);
+      for (auto& i : w) i.resize(n);
+
+      auto generator = Acquire();
+      auto& pb = generator->pb;
+      for (int64_t j = 0; j < n; ++j) {
+        generator->gadget.Assign(get_x(j));
+        assert(pb.is_satisfied());
+        auto const& v = pb.full_variable_assignment();
+        for (int64_t k = 0; k < s; ++k) w[k][j] = v[k];
+      }
+      Release(std::move(generator));
+    }
+
+   private:
+    struct Generator {
+      explicit Generator(Key const& key) : gadget(pb, key) {
+        pb.set_input_sizes(0);
+      }
+      libsnark::protoboard<Fr> pb;
+      Gadget gadget;
+    };
+
+    std::unique_ptr<Generator> Acquire() const {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!generators_.empty()) {
+          auto ret = std::move(generators_.back());
+          generators_.pop_back();
+          return ret;
+        }
+      }
+      return std::unique_ptr<Generator>(new Generator(key_));
+    }
+
+    void Release(std::unique_ptr<Generator> generator) const {
+      std::lock_guard<std::mutex> lock(mutex_);
+      generators_.push_back(std::move(generator));
+    }
+
+    Key const key_;  // the gadgets may keep a reference
+    std::shared_ptr<R1csInfo const> r1cs_info_;
+    mutable std::mutex mutex_;
+    mutable std::vector<std::unique_ptr<Generator>> generators_;
+  };
+
+  struct Stats {
+    int64_t hits = 0;
+    int64_t misses = 0;
+    int64_t evictions = 0;
+    int64_t size = 0;
+    std::string to_string() const {
+      return "hits: " + std::to_string(hits) +
+             ", misses: " + std::to_string(misses) +
+             ", evictions: " + std::to_string(evictions) +
+             ", size: " + std::to_string(size);
+    }
+  };
+
+  static QueryCircuitCache& Instance() {
+    static QueryCircuitCache instance;
+    return instance;
+  }
+
+  void set_capacity(int64_t capacity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    capacity_ = std::max<int64_t>(1, capacity);
+    Evict();
+  }
+
+  // only the first caller of a missed key builds, the others wait
+  std::shared_ptr<Circuit const> Get(Key const& key) {
+    auto name = QueryCircuitKey(key);
+    std::shared_ptr<Entry> entry;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto found = index_.find(name);
+      if (found != index_.end()) {
+        ++stats_.hits;
+        lru_.splice(lru_.begin(), lru_, found->second);
+        entry = found->second->second;
+      } else {
+        ++stats_.misses;
+        entry.reset(new Entry);
+        lru_.emplace_front(name, entry);
+        index_[name] = lru_.begin();
+        Evict();
+      }
+    }
+
+    std::call_once(entry->once, [&key, &name, &entry]() {
+      Tick tick(__FN__, name);
+      entry->circuit.reset(new Circuit(key));
+    });
+    return entry->circuit;
+  }
+
+  Stats stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto ret = stats_;
+    ret.size = (int64_t)lru_.size();
+    return ret;
+  }
+
+ private:
+  QueryCircuitCache() {}
+
+  struct Entry {
+    std::once_flag once;
+    std::shared_ptr<Circuit const> circuit;
+  };
+
+  using Lru = std::list<std::pair<std::string, std::shared_ptr<Entry>>>;
+
+  void Evict() {
+    while ((int64_t)lru_.size() > capacity_) {
+      index_.erase(lru_.back().first);
+      lru_.pop_back();
+      ++stats_.evictions;
+    }
+  }
+
+  mutable std::mutex mutex_;
+  int64_t capacity_ = 64;
+  Lru lru_;
+  std::unordered_map<std::string, typename Lru::iterator> index_;
+  Stats stats_;
+};
+}  // namespace clink
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <libsnark/relations/constraint_satisfaction_problems/r1cs/r1cs.hpp>
+
+#include "./details.h"
+
+// the A, B, C matrices of a r1cs in csr format, compiled once per circuit.
+// row i is the linear combination of constraint i, column k is the variable k
+// of w (libsnark index k+1), the constant term (libsnark index 0) is kept
+// apart. in every row the entries with coefficient one come first so that
+// they need only an add, the others are sorted by coefficient so that the
+// points sharing a coefficient are summed before one multiplication.
+// w: matrix<Fr, s, n>, x = A*w, y = B*w, z = C*w, x,y,z: matrix<Fr, m, n>
+
+namespace clink {
+
+struct R1csCsr {
+  struct Matrix {
+    std::vector<int64_t> row_begin;   // size = m + 1
+    std::vector<int64_t> row_unit;    // size = m, end of the coefficient one
+    std::vector<Fr> constant;         // size = m
+    std::vector<int64_t> col;         // size = nnz
+    std::vector<Fr> coeff;            // size = nnz
+    std::vector<int64_t> same_as;     // size = m, first identical row
+    int64_t m() const { return (int64_t)constant.size(); }
+    int64_t nnz() const { return (int64_t)col.size(); }
+  };
+
+  R1csCsr() {}
+
+  explicit R1csCsr(libsnark::r1cs_constraint_system<Fr> const& cs) {
+    using Constraint = libsnark::r1cs_constraint<Fr>;
+    std::array<Matrix*, 3> mats{&a, &b, &c};
+    std::array<libsnark::linear_combination<Fr> Constraint::*, 3> lcs{
+        &Constraint::a, &Constraint::b, &Constraint::c};
+    auto pf = [&cs, &mats, &lcs](int64_t k) {
+      Compile(cs.constraints, lcs[k], *mats[k]);
+    };
+    parallel::For((int64_t)mats.size(), pf);
+  }
+
+  int64_t m() const { return a.m(); }
+
+  // out[i][j] = <row i, column j of w>, out must be m*n. Out is
+  // vector<vector<Fr>> or misc::Matrix<Fr>.
+  template <typename Out>
+  static void Evaluate(Matrix const& mat,
+                       std::vector<std::vector<Fr>> const& w, Out& out) {
+    auto m = mat.m();
+    if (!m) return;
+    int64_t n = (int64_t)out[0].size();
+    if (!n) return;
+    // a block of one output row stays in l1 while its terms are added
+    int64_t block = std::min<int64_t>(n, kBlockSize);
+    int64_t block_count = (n + block - 1) / block;
+
+    auto pf = [&mat, &w, &out, n, block, block_count](int64_t task) {
+      int64_t i = task / block_count;
+      int64_t begin = (task % block_count) * block;
+      int64_t end = std::min(begin + block, n);
+      Fr* row = out[i].data();
+      auto const& constant = mat.constant[i];
+      for (int64_t j = begin; j < end; ++j) row[j] = constant;
+
+      int64_t k = mat.row_begin[i];
+      for (; k < mat.row_unit[i]; ++k) {
+        Fr const* wk = w[mat.col[k]].data();
+        for (int64_t j = begin; j < end; ++j) row[j] += wk[j];
+      }
+      for (; k < mat.row_begin[i + 1]; ++k) {
+        Fr const* wk = w[mat.col[k]].data();
+        auto const& coeff = mat.coeff[k];
+        for (int64_t j = begin; j < end; ++j) row[j] += wk[j] * coeff;
+      }
+    };
+    parallel::For(m * block_count, pf, m * n < 16 * 1024);
+  }
+
+  // x = A*w, y = B*w, z = C*w
+  template <typename Out>
+  void Evaluate(std::vector<std::vector<Fr>> const& w, Out& x, Out& y,
+                Out& z) const {
+    Tick tick(__FN__);
+    Evaluate(a, w, x);
+    Evaluate(b, w, y);
+    Evaluate(c, w, z);
+  }
+
+  // out[i] = constant[i] * base + sum(coeff[k] * v[col[k]]), T: G1 or Fr
+  // identical rows are computed once
+  template <typename T>
+  static void MulVec(Matrix const& mat, std::vector<T> const& v, T const& base,
+                     std::vector<T>& out) {
+    auto m = mat.m();
+    out.resize(m);
+
+    auto pf = [&mat, &v, &base, &out](int64_t i) {
+      if (mat.same_as[i] != i) return;
+      auto& ret = out[i];
+      ret = RowProduct(mat, i, v);
+      auto const& constant = mat.constant[i];
+      if (constant == FrOne()) {
+        ret += base;
+      } else if (!constant.isZero()) {
+        ret += base * constant;
+      }
+    };
+    parallel::For(m, pf, m < 1024);
+
+    for (int64_t i = 0; i < m; ++i) {
+      if (mat.same_as[i] != i) out[i] = out[mat.same_as[i]];
+    }
+  }
+
+  Matrix a;
+  Matrix b;
+  Matrix c;
+
+ private:
+  enum { kBlockSize = 1024, kMultiExpThreshold = 16 };
+
+  template <typename T>
+  static T RowProduct(Matrix const& mat, int64_t i, std::vector<T> const& v) {
+    T ret;
+    if constexpr (std::is_same<T, G1>::value) {
+      ret = G1Zero();
+    } else {
+      ret = FrZero();
+    }
+
+    int64_t k = mat.row_begin[i];
+    for (; k < mat.row_unit[i]; ++k) ret += v[mat.col[k]];
+
+    // sum the points of the same coefficient first
+    std::vector<T> sums;
+    std::vector<Fr const*> coeffs;
+    for (; k < mat.row_begin[i + 1]; ++k) {
+      auto const& coeff = mat.coeff[k];
+      if (coeffs.empty() || *coeffs.back() != coeff) {
+        sums.push_back(v[mat.col[k]]);
+        coeffs.push_back(&coeff);
+      } else {
+        sums.back() += v[mat.col[k]];
+      }
+    }
+
+    if constexpr (std::is_same<T, G1>::value) {
+      if ((int64_t)sums.size() >= kMultiExpThreshold) {
+        auto get_g = [&sums](int64_t j) -> G1 const& { return sums[j]; };
+        auto get_f = [&coeffs](int64_t j) -> Fr const& { return *coeffs[j]; };
+        ret += MultiExpBdlo12<G1>(get_g, get_f, sums.size());
+        return ret;
+      }
+    }
+    for (size_t j = 0; j < sums.size(); ++j) ret += sums[j] * *coeffs[j];
+    return ret;
+  }
+
+  static void Compile(
+      std::vector<libsnark::r1cs_constraint<Fr>> const& constraints,
+      libsnark::linear_combination<Fr> libsnark::r1cs_constraint<Fr>::*lc,
+      Matrix& mat) {
+    size_t m = constraints.size();
+    mat.row_begin.resize(m + 1);
+    mat.row_unit.resize(m);
+    mat.constant.resize(m);
+    mat.same_as.resize(m);
+
+    std::map<int64_t, Fr> terms;
+    std::vector<std::pair<h256_t, int64_t>> others;
+    std::map<std::string, int64_t> rows;
+    std::string row_key;
+    for (size_t i = 0; i < m; ++i) {
+      terms.clear();
+      auto& constant = mat.constant[i];
+      constant = FrZero();
+      for (auto const& term : (constraints[i].*lc).terms) {
+        if (term.index == 0) {
+          constant += term.coeff;
+        } else {
+          auto it = terms.emplace((int64_t)term.index - 1, FrZero()).first;
+          it->second += term.coeff;
+        }
+      }
+
+      auto begin = (int64_t)mat.col.size();
+      mat.row_begin[i] = begin;
+      others.clear();
+      for (auto const& t : terms) {
+        if (t.second == FrZero()) continue;
+        if (t.second == FrOne()) {
+          mat.col.push_back(t.first);
+          mat.coeff.push_back(t.second);
+        } else {
+          others.emplace_back(FrToBin(t.second), t.first);
+        }
+      }
+      mat.row_unit[i] = (int64_t)mat.col.size();
+      std::sort(others.begin(), others.end());
+      for (auto const& t : others) {
+        mat.col.push_back(t.second);
+        mat.coeff.push_back(terms[t.second]);
+      }
+
+      row_key.assign((char const*)FrToBin(constant).data(), sizeof(h256_t));
+      auto end = (int64_t)mat.col.size();
+      for (int64_t k = begin; k < end; ++k) {
+        row_key.append((char const*)&mat.col[k], sizeof(int64_t));
+        row_key.append((char const*)FrToBin(mat.coeff[k]).data(),
+                       sizeof(h256_t));
+      }
+      mat.same_as[i] = rows.emplace(row_key, (int64_t)i).first->second;
+    }
+    mat.row_begin[m] = (int64_t)mat.col.size();
+  }
+};
+
+}  // namespace clink
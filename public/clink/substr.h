@@ -2,6 +2,7 @@
 
 #include "./details.h"
 #include "./parallel_r1cs.h"
+#include "./query_circuit_cache.h"
 #include "circuit/has0_gadget.h"
 #include "circuit/substr_gadget.h"
 
@@ -18,6 +19,7 @@ struct Substr {
   using Sec53 = typename Policy::Sec53;
   using HyraxA = typename Policy::HyraxA;
   using R1cs = typename clink::ParallelR1cs<Policy>;
+  using CircuitCache = QueryCircuitCache<circuit::SubstrGadget, std::string>;
 
   struct Proof {
     typename R1cs::Proof r1cs_proof;
@@ -53,25 +55,17 @@ struct Substr {
           com_y_r(com_y_r),
           get_g(get_g),
           n((int64_t)x.size()) {
-      libsnark::protoboard<Fr> pb;
-      circuit::SubstrGadget gadget(pb, k);
-      int64_t const primary_input_size = 0;
-      pb.set_input_sizes(primary_input_size);
-      r1cs_info.reset(new R1csInfo(pb));
+      auto circuit = CircuitCache::Instance().Get(k);
+      r1cs_info = circuit->r1cs_info();
       s = r1cs_info->num_variables;
-      w.resize(s);
-      for (auto& i : w) i.resize(n);
-
+      auto get_x = [&x](int64_t j) -> Fr const& { return x[j]; };
+      circuit->Witness(n, get_x, w);
+#ifdef _DEBUG
       for (int64_t j = 0; j < n; ++j) {
-        gadget.Assign(x[j]);
-        assert(pb.is_satisfied());
-        auto v = pb.full_variable_assignment();
-        for (int64_t i = 0; i < s; ++i) {
-          w[i][j] = v[i];
-        }
         assert(w.front()[j] == x[j]);
         assert(w.back()[j] == y[j]);
       }
+#endif
     }
     std::string const& k;
     std::vector<Fr> const& x;
@@ -83,7 +77,7 @@ struct Substr {
     GetRefG1 const& get_g;
 
     int64_t const n;
-    std::unique_ptr<R1csInfo> r1cs_info;
+    std::shared_ptr<R1csInfo const> r1cs_info;
     int64_t s;
     std::vector<std::vector<Fr>> mutable w;
   };
@@ -117,11 +111,7 @@ struct Substr {
   struct VerifyInput {
     VerifyInput(int64_t n, std::string const& k, GetRefG1 const& get_g)
         : n(n), k(k), get_g(get_g) {
-      libsnark::protoboard<Fr> pb;
-      circuit::SubstrGadget gadget(pb, k);
-      int64_t const primary_input_size = 0;
-      pb.set_input_sizes(primary_input_size);
-      r1cs_info.reset(new R1csInfo(pb));
+      r1cs_info = CircuitCache::Instance().Get(k)->r1cs_info();
       m = r1cs_info->num_constraints;
       s = r1cs_info->num_variables;
     }
@@ -129,7 +119,7 @@ struct Substr {
     std::string const& k;
     GetRefG1 const& get_g;
 
-    std::unique_ptr<R1csInfo> r1cs_info;
+    std::shared_ptr<R1csInfo const> r1cs_info;
     int64_t m;
     int64_t s;
     // since primary_input_size = 0, public_w is empty
@@ -140,6 +130,13 @@ struct Substr {
   static bool Verify(Proof const& proof, h256_t seed,
                      VerifyInput const& input) {
     Tick tick(__FN__);
+    MultiExpAcc acc;
+    return Verify(proof, seed, input, acc) && acc.Check();
+  }
+
+  // defers the multiexp checks to acc
+  static bool Verify(Proof const& proof, h256_t seed, VerifyInput const& input,
+                     MultiExpAcc& acc) {
     if ((int64_t)proof.com_w.size() != input.s) {
       assert(false);
       return false;
@@ -153,7 +150,8 @@ struct Substr {
     typename ParallelR1cs<Policy>::VerifyInput pr_input(
         input.n, *input.r1cs_info, "substr", proof.com_w, input.public_w,
         input.get_g);
-    return ParallelR1cs<Policy>::Verify(proof.r1cs_proof, seed, pr_input);
+    return ParallelR1cs<Policy>::Verify(proof.r1cs_proof, seed, pr_input,
+                                        acc);
   }
 
   static bool Test();
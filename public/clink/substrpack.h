@@ -120,15 +120,22 @@ struct SubstrPack {
 
   static bool Verify(Proof const& proof, h256_t seed,
                      VerifyInput const& input) {
+    MultiExpAcc acc;
+    return Verify(proof, seed, input, acc) && acc.Check();
+  }
+
+  // defers the multiexp checks to acc
+  static bool Verify(Proof const& proof, h256_t seed, VerifyInput const& input,
+                     MultiExpAcc& acc) {
     typename Substr<Policy>::VerifyInput s_input(input.n, input.k,
                                                  input.get_gx);
-    if (!Substr<Policy>::Verify(proof.substr_proof, seed, s_input))
+    if (!Substr<Policy>::Verify(proof.substr_proof, seed, s_input, acc))
       return false;
 
     G1 const& com_y = proof.substr_proof.com_w.back();
     typename Pack<HyraxA>::VerifyInput p_input(input.n, com_y, input.get_gx,
                                                proof.com_pack_y, input.get_gpy);
-    return Pack<HyraxA>::Verify(proof.pack_proof, seed, p_input);
+    return Pack<HyraxA>::Verify(proof.pack_proof, seed, p_input, acc);
   }
 
   static bool Test(int64_t n, std::string const& k);
@@ -19,7 +19,7 @@ struct Sudoku {
 
   struct Proof {
     clink::ParallelR1cs<Policy>::Proof r1cs_proof;
-    hyrax::A4::Proof adapt_proof;
+    AdaptProof adapt_proof;
     G1 com_x; // x is vector of the puzzle
     G1 com_y; // y is pack format of the x, for the later pod
     std::vector<G1> com_w;
@@ -8,7 +8,7 @@ inline void OneConvInputProvePreprocess(h256_t seed,
                                         ProveContext const& context,
                                         size_t layer, OneConvProof& proof,
                                         OneConvInputSec& input_sec,
-                                        SafeVec<AdaptProveItem>& adapt_man) {
+                                        AdaptProveAcc& adapt_man) {
   Tick tick(__FN__, std::to_string(layer));
 
   CHECK(kLayerTypeOrders[layer].first == kConv, "");
@@ -28,55 +28,38 @@ inline void OneConvInputProvePreprocess(h256_t seed,
   auto DD = D * D;
   auto CDD = C * DD;
   auto KCDD = K * CDD;
-  auto const& x = input_image.pixels;
-  auto const& vec_x = input_image.data;
+  auto const& x = input_image.data;
   Fr const& rx = context.image_com_sec().r[layer];
   G1 const& cx = context.image_com_pub().c[layer];
   FrRand(input_sec.rb.data(), input_sec.rb.size());
 
-  // build input_sec.b and ctx.B
-  ctx.B.resize(KCDD);
+  // build ctx.B and input_sec.b
+  OneConvBuildInputIndex(C, D, ctx.B);
   input_sec.b.resize(KCDD);
   for (size_t i = 0; i < CDD; ++i) {
     for (size_t j = 0; j < 9; ++j) {
-      size_t m = j / 3;
-      size_t n = j % 3;
-      size_t r = i / DD;
-      size_t p = i % DD;
-      size_t q = p / D;
-      size_t o = p % D;
-      size_t ii = q + m;
-      size_t jj = o + n;
-      if (ii == 0 || jj == 0 || ii == (D + 1) || jj == (D + 1)) {
-        input_sec.b[i][j] = &FrZero();
-        ctx.B[i][j] = -1;
-      } else {
-        input_sec.b[i][j] = &x[r][ii - 1][jj - 1];
-        ctx.B[i][j] = r * D * D + (ii - 1) * D + (jj - 1);
-      }
+      auto const& Bij = ctx.B[i][j];
+      input_sec.b[i][j] = Bij == -1 ? &FrZero() : &x[Bij];
     }
   }
 
-  // commit every col of input_sec.b
-  auto get_col_b_u = [&context, order](int64_t i) -> G1 const& {
-    auto range = context.auxi().data_u_conv(order);
-    CHECK(i < (range.second - range.first), "");
-    return range.first[i];
-  };
+  // commit every col of input_sec.b by the aggregated bases
+  auto range = context.auxi().data_u_conv(order);
+  CHECK(range.second - range.first >= (int64_t)CDD, "");
+  GetRefG1 get_u = [&range](int64_t i) -> G1 const& { return range.first[i]; };
 
-  auto parallel_f1 = [&input_sec, &input_pub, &get_col_b_u, C, D](int64_t j) {
-    auto get_x = [&input_sec, j](int64_t i) -> Fr const& {
-      return *input_sec.b[i][j];
-    };
-    input_pub.cb[j] =
-        pc::ComputeCom(C * D * D, get_col_b_u, get_x, input_sec.rb[j]);
+  std::array<std::vector<Fr>, 9> b;
+  auto parallel_f1 = [&input_sec, &input_pub, &b, &get_u, CDD](int64_t j) {
+    b[j].resize(CDD);
+    for (size_t i = 0; i < CDD; ++i) b[j][i] = *input_sec.b[i][j];
+    input_pub.cb[j] = pc::ComputeCom(get_u, b[j], input_sec.rb[j]);
   };
   parallel::For(9, parallel_f1);
 
-  // extend input_sec.b (to input_sec.b'), now input_sec.b is [KCDD][9]
+  // extend input_sec.b (to input_sec.b') for the r1cs, now input_sec.b is
+  // [KCDD][9], only the pointers are replicated
   for (size_t i = CDD; i < KCDD; ++i) {
     input_sec.b[i] = input_sec.b[i % (CDD)];
-    ctx.B[i] = ctx.B[i % (CDD)];
   }
 
   if (DEBUG_CHECK) {
@@ -93,37 +76,46 @@ inline void OneConvInputProvePreprocess(h256_t seed,
   // update seed by input_pub.cb
   OneConvUpdateSeed(seed, input_pub.cb);
 
-  // compute challenge ctx.r base on fst
-  OneConvComputeInputR(seed, layer, KCDD, ctx.r);
+  // compute challenge ctx.r base on fst, the K replicas of a column share
+  // the same data, so r is drawn for the CDD rows only
+  OneConvComputeInputR(seed, layer, CDD, ctx.r);
 
   // build ctx.q base ctx.B and ctx.r
-  ctx.q.resize(CDD, FrZero());
-  for (size_t j = 0; j < 9; ++j) {
-    for (size_t i = 0; i < KCDD; ++i) {
-      auto const& Bij = ctx.B[i][j];
-      if (Bij != -1) {
-        ctx.q[Bij] += ctx.r[j][i];
-      }
-    }
-  }
-
+  ctx.q = OneConvComputeInputQ(CDD, ctx.B, ctx.r);
+
+  // t = sum(<b_j, r_j>) = <x, q>
+  Fr t = FrZero();
+  for (size_t j = 0; j < 9; ++j) t += InnerProduct(b[j], ctx.r[j]);
+  Fr rt = FrRand();
+  input_pub.ct = pc::ComputeCom(t, rt);
+
+  // prove t over the unreplicated columns and the bases u
+  hyrax::A4::CommitmentPub com_pub;
+  com_pub.cx.assign(input_pub.cb.begin(), input_pub.cb.end());
+  com_pub.cz = input_pub.ct;
+  hyrax::A4::CommitmentSec com_sec;
+  com_sec.r.assign(input_sec.rb.begin(), input_sec.rb.end());
+  com_sec.t = rt;
+  std::vector<std::vector<Fr>> a4_x(b.begin(), b.end());
+  std::vector<std::vector<Fr>> a4_a(ctx.r.begin(), ctx.r.end());
+  hyrax::A4::ProveInput a4_input(ConvAdaptTag(true, layer), std::move(a4_x),
+                                 std::move(a4_a), t, get_u, pc::PcG(0));
+  hyrax::A4::Prove(input_pub.a4_proof, seed, std::move(a4_input),
+                   std::move(com_pub), std::move(com_sec));
+
+  // prove t = <x, q>
   AdaptProveItem adapt_item;
-  adapt_item.Init(10, "conv_input_" + std::to_string(layer), FrZero());
-  for (size_t j = 0; j < 9; ++j) {
-    adapt_item.x[j].resize(KCDD);
-    for (size_t i = 0; i < KCDD; ++i) {
-      adapt_item.x[j][i] = *input_sec.b[i][j];
-    }
-    adapt_item.a[j] = ctx.r[j];
-    adapt_item.cx[j] = input_pub.cb[j];
-    adapt_item.rx[j] = input_sec.rb[j];
-  }
-  adapt_item.x.back() = vec_x;
-  adapt_item.a.back() = -ctx.q;
-  adapt_item.cx.back() = cx;
-  adapt_item.rx.back() = rx;
+  adapt_item.Init(2, ConvAdaptTag(true, layer), FrZero());
+  adapt_item.x[0] = x;
+  adapt_item.a[0] = -ctx.q;
+  adapt_item.cx[0] = cx;
+  adapt_item.rx[0] = rx;
+  adapt_item.x[1] = std::vector<Fr>{t};
+  adapt_item.a[1] = std::vector<Fr>{FrOne()};
+  adapt_item.cx[1] = input_pub.ct;
+  adapt_item.rx[1] = rt;
 
-  adapt_man.emplace(std::move(adapt_item));
+  adapt_man.Add(std::move(adapt_item));
 }
 
 // prove y=<x,para>
@@ -131,7 +123,7 @@ inline void OneConvR1csProvePreprocess(
     h256_t seed, ProveContext const& context, size_t layer,
     OneConvInputSec const& input_sec, OneConvProof& proof,
     std::shared_ptr<OneConvR1csSec> pr1cs_sec,
-    SafeVec<R1csProveItem>& r1cs_man) {
+    R1csProveCollector& r1cs_man) {
   Tick tick(__FN__, std::to_string(layer));
   (void)seed;
   auto K = kImageInfos[layer + 1].C;
@@ -220,7 +212,7 @@ inline void OneConvOutputProvePreprocess(h256_t seed,
                                          size_t layer,
                                          OneConvR1csSec const& r1cs_sec,
                                          OneConvProof& proof,
-                                         SafeVec<AdaptProveItem>& item_man) {
+                                         AdaptProveAcc& item_man) {
   Tick tick(__FN__, std::to_string(layer));
   namespace fp = circuit::fp;
   size_t const order = kLayerTypeOrders[layer].second;
@@ -287,7 +279,7 @@ inline void OneConvOutputProvePreprocess(h256_t seed,
   DCHECK(InnerProduct(y, r) == InnerProduct(x, s), "");
 
   AdaptProveItem adapt_item;
-  adapt_item.Init(2, "conv_output_" + std::to_string(layer), FrZero());
+  adapt_item.Init(2, ConvAdaptTag(false, layer), FrZero());
   adapt_item.x[0] = x;  // ref to r1cs_sec.y, so copy it
   adapt_item.a[0] = std::move(s);
   adapt_item.cx[0] = cx;
@@ -298,13 +290,13 @@ inline void OneConvOutputProvePreprocess(h256_t seed,
   adapt_item.cx[1] = output_pub.cy;
   adapt_item.rx[1] = ry;
 
-  item_man.emplace(std::move(adapt_item));
+  item_man.Add(std::move(adapt_item));
 }
 
 inline void OneConvProvePreprocess(h256_t seed, ProveContext const& context,
                                    size_t layer, OneConvProof& proof,
-                                   SafeVec<AdaptProveItem>& adapt_man,
-                                   SafeVec<R1csProveItem>& r1cs_man) {
+                                   AdaptProveAcc& adapt_man,
+                                   R1csProveCollector& r1cs_man) {
   Tick tick(__FN__, std::to_string(layer));
   OneConvInputSec input_sec;
   OneConvInputProvePreprocess(seed, context, layer, proof, input_sec,
@@ -29,20 +29,31 @@ inline void OneConvUpdateSeed(h256_t& seed, G1 const& c) {
   hash.Final(seed.data());
 }
 
+// cb[j]: com(u, b_j), b_j is the column j of the CDD*9 input, u is the
+// aggregated bases (data_u_conv), so cb[j] is also com(g, b_j') of the K
+// replicas b_j' that the r1cs uses.
+// ct: com(g, t), t = sum(<b_j, r_j>), a4_proof proves t over the CDD columns
+// and the adapt item proves t = <x, q>.
 struct OneConvInputPub {
   std::array<G1, 9> cb;
+  G1 ct;
+  hyrax::A4::Proof a4_proof;
 
-  bool operator==(OneConvInputPub const& b) const { return cb == b.cb; }
+  bool operator==(OneConvInputPub const& b) const {
+    return cb == b.cb && ct == b.ct && a4_proof == b.a4_proof;
+  }
 
   bool operator!=(OneConvInputPub const& b) const { return !(*this == b); }
 
   template <typename Ar>
   void serialize(Ar& ar) const {
-    ar& YAS_OBJECT_NVP("vgg16.OneConvInputPub", ("cb", cb));
+    ar& YAS_OBJECT_NVP("vgg16.OneConvInputPub", ("cb", cb), ("ct", ct),
+                       ("a4", a4_proof));
   }
   template <typename Ar>
   void serialize(Ar& ar) {
-    ar& YAS_OBJECT_NVP("vgg16.OneConvInputPub", ("cb", cb));
+    ar& YAS_OBJECT_NVP("vgg16.OneConvInputPub", ("cb", cb), ("ct", ct),
+                       ("a4", a4_proof));
   }
 };
 
@@ -135,10 +146,11 @@ inline void OneConvComputeFst(h256_t const& seed, std::string const& prefix,
   ComputeFst(seed, salt, r);
 }
 
-inline void OneConvComputeInputR(h256_t const& seed, size_t layer, size_t KCDD,
+// r[j]: size = CDD, the columns are not replicated
+inline void OneConvComputeInputR(h256_t const& seed, size_t layer, size_t CDD,
                                  std::array<std::vector<Fr>, 9>& r) {
-  auto parallel_f = [&seed, &r, layer, KCDD](int64_t j) {
-    r[j].resize(KCDD);
+  auto parallel_f = [&seed, &r, layer, CDD](int64_t j) {
+    r[j].resize(CDD);
     OneConvComputeFst(seed, "conv adapt input ", layer, j, r[j]);
   };
   parallel::For(9, parallel_f);
@@ -174,6 +186,44 @@ inline std::string ConvR1csTag(size_t layer) {
   return tag + std::to_string(layer);
 }
 
+// B[i][j]: the index in x of b_j[i], -1 for the padding
+inline void OneConvBuildInputIndex(size_t C, size_t D,
+                                   std::vector<std::array<int64_t, 9>>& B) {
+  auto DD = D * D;
+  B.resize(C * DD);
+  for (size_t i = 0; i < C * DD; ++i) {
+    for (size_t j = 0; j < 9; ++j) {
+      size_t m = j / 3;
+      size_t n = j % 3;
+      size_t r = i / DD;
+      size_t p = i % DD;
+      size_t q = p / D;
+      size_t o = p % D;
+      size_t ii = q + m;
+      size_t jj = o + n;
+      if (ii == 0 || jj == 0 || ii == (D + 1) || jj == (D + 1)) {
+        B[i][j] = -1;
+      } else {
+        B[i][j] = r * DD + (ii - 1) * D + (jj - 1);
+      }
+    }
+  }
+}
+
+// q[k] = sum(r[j][i]), B[i][j] = k
+inline std::vector<Fr> OneConvComputeInputQ(
+    size_t CDD, std::vector<std::array<int64_t, 9>> const& B,
+    std::array<std::vector<Fr>, 9> const& r) {
+  std::vector<Fr> q(CDD, FrZero());
+  for (size_t j = 0; j < 9; ++j) {
+    for (size_t i = 0; i < CDD; ++i) {
+      auto const& Bij = B[i][j];
+      if (Bij != -1) q[Bij] += r[j][i];
+    }
+  }
+  return q;
+}
+
 inline std::string ConvAdaptTag(bool in, size_t layer) {
   static const std::string in_tag = "conv in ";
   static const std::string out_tag = "conv out ";
@@ -8,7 +8,7 @@ inline bool OneConvInputVerifyPreprocess(h256_t seed,
                                          VerifyContext const& context,
                                          size_t layer,
                                          OneConvProof const& proof,
-                                         SafeVec<AdaptVerifyItem>& adapt_man) {
+                                         AdaptVerifyAcc& adapt_man) {
   Tick tick(__FN__);
 
   struct Ctx {
@@ -17,69 +17,51 @@ inline bool OneConvInputVerifyPreprocess(h256_t seed,
     std::vector<Fr> q;
   } ctx;
 
-  auto K = kImageInfos[layer + 1].C;
+  auto const& input_pub = proof.input_pub;
+  size_t const order = kLayerTypeOrders[layer].second;
   auto C = kImageInfos[layer].C;
   auto D = kImageInfos[layer].D;
-  auto DD = D * D;
-  auto CDD = C * DD;
-  auto KCDD = K * CDD;
-
-  // build B
-  ctx.B.resize(KCDD);
-  for (size_t i = 0; i < CDD; ++i) {
-    for (size_t j = 0; j < 9; ++j) {
-      size_t m = j / 3;
-      size_t n = j % 3;
-      size_t r = i / (D * D);
-      size_t p = i % (D * D);
-      size_t q = p / D;
-      size_t o = p % D;
-      size_t ii = q + m;
-      size_t jj = o + n;
-      if (ii == 0 || jj == 0 || ii == (D + 1) || jj == (D + 1)) {
-        ctx.B[i][j] = -1;
-      } else {
-        ctx.B[i][j] = r * D * D + (ii - 1) * D + (jj - 1);
-      }
-    }
-  }
+  auto CDD = C * D * D;
 
-  // extend ctx.B
-  for (size_t i = CDD; i < KCDD; ++i) {
-    ctx.B[i] = ctx.B[i % (CDD)];
-  }
+  OneConvBuildInputIndex(C, D, ctx.B);
 
-  OneConvUpdateSeed(seed, proof.input_pub.cb);
-  OneConvComputeInputR(seed, layer, KCDD, ctx.r);
+  OneConvUpdateSeed(seed, input_pub.cb);
+  OneConvComputeInputR(seed, layer, CDD, ctx.r);
 
   // build q base ctx.B and ctx.r
-  ctx.q.resize(CDD, FrZero());
-  for (size_t j = 0; j < 9; ++j) {
-    for (size_t i = 0; i < KCDD; ++i) {
-      auto const& Bij = ctx.B[i][j];
-      if (Bij != -1) {
-        ctx.q[Bij] += ctx.r[j][i];
-      }
-    }
+  ctx.q = OneConvComputeInputQ(CDD, ctx.B, ctx.r);
+
+  // t over the unreplicated columns and the bases u
+  auto range = context.auxi().data_u_conv(order);
+  if (range.second - range.first < (int64_t)CDD) return false;
+  GetRefG1 get_u = [&range](int64_t i) -> G1 const& { return range.first[i]; };
+  hyrax::A4::CommitmentPub com_pub;
+  com_pub.cx.assign(input_pub.cb.begin(), input_pub.cb.end());
+  com_pub.cz = input_pub.ct;
+  std::vector<std::vector<Fr>> a4_a(ctx.r.begin(), ctx.r.end());
+  hyrax::A4::VerifyInput a4_input(ConvAdaptTag(true, layer), std::move(com_pub),
+                                  get_u, std::move(a4_a), pc::PcG(0));
+  if (!hyrax::A4::Verify(input_pub.a4_proof, seed, std::move(a4_input))) {
+    assert(false);
+    return false;
   }
 
+  // t = <x, q>
   AdaptVerifyItem adapt_item;
-  adapt_item.Init(10, ConvAdaptTag(true, layer), FrZero());
-  for (size_t j = 0; j < 9; ++j) {
-    adapt_item.a[j] = ctx.r[j];
-    adapt_item.cx[j] = proof.input_pub.cb[j];
-  }
-  adapt_item.a.back() = -ctx.q;
-  adapt_item.cx.back() = context.image_com_pub().c[layer];
+  adapt_item.Init(2, ConvAdaptTag(true, layer), FrZero());
+  adapt_item.a[0] = -ctx.q;
+  adapt_item.cx[0] = context.image_com_pub().c[layer];
+  adapt_item.a[1] = std::vector<Fr>{FrOne()};
+  adapt_item.cx[1] = input_pub.ct;
 
-  adapt_man.emplace(std::move(adapt_item));
+  adapt_man.Add(std::move(adapt_item));
   return true;
 }
 
 inline bool OneConvR1csVerifyPreprocess(h256_t seed,
                                         VerifyContext const& context,
                                         size_t layer, OneConvProof const& proof,
-                                        SafeVec<R1csVerifyItem>& r1cs_man) {
+                                        R1csVerifyCollector& r1cs_man) {
   Tick tick(__FN__);
   (void)seed;
   auto K = kImageInfos[layer + 1].C;
@@ -117,7 +99,7 @@ inline bool OneConvOutputVerifyPreprocess(h256_t seed,
                                           VerifyContext const& context,
                                           size_t layer,
                                           OneConvProof const& proof,
-                                          SafeVec<AdaptVerifyItem>& adapt_man) {
+                                          AdaptVerifyAcc& adapt_man) {
   Tick tick(__FN__);
   namespace fp = circuit::fp;
   auto K = kImageInfos[layer + 1].C;
@@ -147,7 +129,7 @@ inline bool OneConvOutputVerifyPreprocess(h256_t seed,
   adapt_item.a[1] = std::move(r);
   adapt_item.a[1] = -adapt_item.a[1];
   adapt_item.cx[1] = proof.output_pub.cy;
-  adapt_man.emplace(std::move(adapt_item));
+  adapt_man.Add(std::move(adapt_item));
 
   return true;
 
@@ -165,8 +147,8 @@ inline bool OneConvOutputVerifyPreprocess(h256_t seed,
 
 inline bool OneConvVerifyPreprocess(h256_t seed, VerifyContext const& context,
                                     size_t layer, OneConvProof const& proof,
-                                    SafeVec<AdaptVerifyItem>& adapt_man,
-                                    SafeVec<R1csVerifyItem>& r1cs_man) {
+                                    AdaptVerifyAcc& adapt_man,
+                                    R1csVerifyCollector& r1cs_man) {
   Tick tick(__FN__, std::to_string(layer));
 
   std::array<parallel::VoidTask, 3> tasks;
@@ -2,6 +2,7 @@
 
 #include "./para_com.h"
 #include "./para_fr.h"
+#include "./infer_int.h"
 #include "./para_pub.h"
 #include "circuit/fixed_point/fixed_point.h"
 #include "circuit/vgg16/vgg16.h"
@@ -248,8 +249,9 @@ inline void InferDense(Para::DenseLayer const& layer, Image const& input_image,
   }
 }
 
-inline void Infer(Para const& para, dbl::Image const& dbl_image,
-                  std::array<std::unique_ptr<Image>, 35>& images) {
+// the reference inference in Fr, see IntInfer
+inline void FrInfer(Para const& para, dbl::Image const& dbl_image,
+                    std::array<std::unique_ptr<Image>, 35>& images) {
   Tick tick(__FN__);
   images[0].reset(new Image(dbl_image));
   for (size_t i = 1; i < images.size(); ++i) {
@@ -323,8 +325,114 @@ inline void Infer(Para const& para, dbl::Image const& dbl_image,
   InferReluBn(para.bn_layer(13), *images[32], *images[33]);
 
   InferDense(para.dense_layer(1), *images[33], *images[34]);
+}
+
+inline void Infer(Para const& para, dbl::Image const& dbl_image,
+                  std::array<std::unique_ptr<Image>, 35>& images) {
+  Tick tick(__FN__);
+#ifdef CLINK_VGG16_INT_INFER
+  IntInfer(para, dbl_image, images);
+#else
+  FrInfer(para, dbl_image, images);
+#endif
+
+#if defined(_DEBUG_CHECK) && defined(CLINK_VGG16_INT_INFER)
+  std::array<std::unique_ptr<Image>, 35> fr_images;
+  FrInfer(para, dbl_image, fr_images);
+  for (size_t i = 0; i < images.size(); ++i) {
+    if (*images[i] != *fr_images[i]) {
+      std::cout << __LINE__ << " oops, image " << i << "\n";
+      throw std::runtime_error("oops");
+    }
+  }
+#endif
 
   images[34]->dump<8, 24 + 24>();
 }
 
+// the int layers against the Fr layers on random small layers
+inline bool TestIntInfer() {
+#ifndef CLINK_VGG16_INT_INFER
+  return true;
+#else
+  Tick tick(__FN__);
+  namespace fp = circuit::fp;
+  namespace ii = int_infer;
+  auto rand_fr = []() {
+    return fp::DoubleToRational<8, 24>((rand() % 20001 - 10000) / 10000.0);
+  };
+  auto rand_image = [&rand_fr](ImageInfo const& info) {
+    std::unique_ptr<Image> ret(new Image(info));
+    for (auto& i : ret->data) i = rand_fr();
+    return ret;
+  };
+  auto check = [](IntImage const& int_image, Image const& image) {
+    Image lifted(ImageInfo{image.order, image.D(), image.C()});
+    ii::ToImage(int_image, lifted);
+    return lifted.data == image.data;
+  };
+
+  size_t const C = 5, K = 12, D = 6;
+  ConvLayerInfo conv_info{0, D, C, K};
+  Para::ConvLayer conv(conv_info);
+  for (auto& i : conv.coefs) {
+    for (auto& j : i) {
+      for (auto& k : j) {
+        for (auto& l : k) l = rand_fr();
+      }
+    }
+  }
+  for (auto& i : conv.bias) i = rand_fr();
+  Para::BnLayer bn(BnLayerInfo{0, D, K});
+  for (size_t i = 0; i < K; ++i) {
+    bn.mu[i] = rand_fr();
+    bn.alpha[i] = rand_fr();
+    bn.beta[i] = rand_fr();
+  }
+  Para::DenseLayer dense(DenseLayerInfo{0, K, 3});
+  for (auto& i : dense.weight) {
+    for (auto& j : i) j = rand_fr();
+  }
+
+  // conv, relubn, pooling, pooling (to D=1), dense
+  auto fr_input = rand_image(ImageInfo{0, D, C});
+  Image fr_conv(ImageInfo{1, D, K});
+  Image fr_bn(ImageInfo{2, D, K});
+  Image fr_pool(ImageInfo{3, D / 2, K});
+  Image fr_pool2(ImageInfo{4, 1, K});
+  Image fr_dense(ImageInfo{5, 1, 3});
+  InferConv(conv, *fr_input, fr_conv);
+  InferReluBn(bn, fr_conv, fr_bn);
+  InferMaxPooling(fr_bn, fr_pool);
+  // D / 2 = 3 is odd, pools the top left 2x2 only
+  Image fr_pool_even(ImageInfo{3, 2, K});
+  for (size_t c = 0; c < K; ++c) {
+    for (size_t i = 0; i < 2; ++i) {
+      for (size_t j = 0; j < 2; ++j) {
+        fr_pool_even.pixels[c][i][j] = fr_pool.pixels[c][i][j];
+      }
+    }
+  }
+  InferMaxPooling(fr_pool_even, fr_pool2);
+  InferDense(dense, fr_pool2, fr_dense);
+
+  IntImage int_input(C, D), int_conv(K, D), int_bn(K, D);
+  IntImage int_pool(K, D / 2), int_pool_even(K, 2), int_pool2(K, 1);
+  IntImage int_dense(3, 1);
+  ii::FromImage(*fr_input, int_input);
+  IntInferConv(conv, int_input, int_conv);
+  IntInferReluBn(bn, int_conv, int_bn);
+  IntInferMaxPooling(int_bn, int_pool);
+  ii::FromImage(fr_pool_even, int_pool_even);
+  IntInferMaxPooling(int_pool_even, int_pool2);
+  IntInferDense(dense, int_pool2, int_dense);
+
+  bool success = check(int_conv, fr_conv) && check(int_bn, fr_bn) &&
+                 check(int_pool, fr_pool) && check(int_pool2, fr_pool2) &&
+                 check(int_dense, fr_dense);
+  std::cout << __FILE__ << " " << __FN__ << ": " << success << "\n\n\n\n\n\n";
+  return success;
+#endif
+}
+
 };  // namespace clink::vgg16
\ No newline at end of file
@@ -0,0 +1,268 @@
+#pragma once
+
+#include "./para_fr.h"
+#include "./para_pub.h"
+#include "circuit/fixed_point/fixed_point.h"
+
+// the inference in native integers, the same results as the Fr inference
+// (infer.h) bit by bit. a <D,N> value is the signed integer value*2^N, every
+// IntImage stores Int128. the <8,24> inputs of the conv and the dense layers
+// are narrowed to int64 so that the products fit Int128 without overflow.
+// the conv is a direct 3x3 stencil over the zero padded input planes, a
+// block of output channels shares each plane, no pixel or coef is copied per
+// output. only the results are lifted to Fr (all of them are committed).
+// needs a native 128 bits integer, without it (msvc) Infer uses FrInfer.
+#ifdef __SIZEOF_INT128__
+#define CLINK_VGG16_INT_INFER
+namespace clink::vgg16 {
+
+typedef __int128 Int128;
+
+struct IntImage {
+  IntImage(size_t c, size_t d) : C(c), D(d), data(c * d * d) {}
+  size_t const C;
+  size_t const D;
+  std::vector<Int128> data;
+  Int128& at(size_t c, size_t i, size_t j) { return data[(c * D + i) * D + j]; }
+  Int128 const& at(size_t c, size_t i, size_t j) const {
+    return data[(c * D + i) * D + j];
+  }
+};
+
+namespace int_infer {
+
+inline int64_t FrToInt(Fr const& fr) {
+  bool neg = fr.isNegative();
+  mpz_class mpz = neg ? (-fr).getMpz() : fr.getMpz();
+  // long may be 32 bits, export the limb instead of get_si
+  CHECK(mpz_sizeinbase(mpz.get_mpz_t(), 2) <= 63, "");
+  uint64_t abs_ret = 0;
+  mpz_export(&abs_ret, nullptr, -1, sizeof(abs_ret), 0, 0, mpz.get_mpz_t());
+  int64_t ret = (int64_t)abs_ret;
+  return neg ? -ret : ret;
+}
+
+inline Fr IntToFr(Int128 x) {
+  if (x >= INT64_MIN && x <= INT64_MAX) return Fr((int64_t)x);
+  bool neg = x < 0;
+  unsigned __int128 abs_x = neg ? -(unsigned __int128)x : x;
+  uint64_t limbs[2] = {(uint64_t)abs_x, (uint64_t)(abs_x >> 64)};
+  mpz_class mpz;
+  mpz_import(mpz.get_mpz_t(), 2, -1, sizeof(uint64_t), 0, 0, limbs);
+  Fr ret;
+  ret.setMpz(mpz);
+  return neg ? -ret : ret;
+}
+
+// same as RationalConst<D, N>().IsOverflow()
+template <size_t D, size_t N>
+bool IsOverflow(Int128 x) {
+  static_assert(D + N < 126, "invalid D or N");
+  Int128 const bound = (Int128)1 << (D + N);
+  return x >= bound || x < -bound;
+}
+
+// same as fp::ReducePrecision<D, N, M>(), floor(a / 2^(N-M))
+template <size_t D, size_t N, size_t M>
+Int128 ReducePrecision(Int128 a) {
+  static_assert(N > M, "invalid N or M");
+  CHECK(!IsOverflow<D, N>(a), "");
+  Int128 const div = (Int128)1 << (N - M);
+  return a >= 0 ? a / div : -((-a + div - 1) / div);
+}
+
+inline int64_t ToInt64(Int128 x) {
+  CHECK(x >= INT64_MIN && x <= INT64_MAX, "");
+  return (int64_t)x;
+}
+
+inline void FromImage(Image const& image, IntImage& ret) {
+  assert(ret.data.size() == image.data.size());
+  auto pf = [&image, &ret](int64_t i) { ret.data[i] = FrToInt(image.data[i]); };
+  parallel::For((int64_t)ret.data.size(), pf);
+}
+
+inline void ToImage(IntImage const& image, Image& ret) {
+  assert(ret.data.size() == image.data.size());
+  auto pf = [&image, &ret](int64_t i) { ret.data[i] = IntToFr(image.data[i]); };
+  parallel::For((int64_t)ret.data.size(), pf);
+}
+}  // namespace int_infer
+
+// input type: <D,N>
+// output type: <D, 2N>
+inline void IntInferConv(Para::ConvLayer const& layer, IntImage const& input,
+                         IntImage& output) {
+  Tick tick(__FN__);
+  namespace ii = int_infer;
+  size_t const C = layer.C();
+  size_t const D = layer.D;
+  size_t const K = layer.K();
+  size_t const P = D + 2;  // the padded plane
+  size_t constexpr kBlockK = 8;
+
+  assert(input.D == D && input.C == C);
+  assert(output.D == D && output.C == K);
+
+  std::vector<int64_t> padded(C * P * P, 0);
+  auto pf_pad = [&padded, &input, D, P](int64_t c) {
+    auto plane = padded.data() + c * P * P;
+    for (size_t i = 0; i < D; ++i) {
+      for (size_t j = 0; j < D; ++j) {
+        plane[(i + 1) * P + j + 1] = ii::ToInt64(input.at(c, i, j));
+      }
+    }
+  };
+  parallel::For((int64_t)C, pf_pad);
+
+  // coefs[(k * C + c) * 9 + m * 3 + n]
+  std::vector<int64_t> coefs(K * C * 9);
+  auto pf_coef = [&coefs, &layer, C](int64_t i) {
+    auto const& coef = layer.coefs[i / C][i % C];
+    for (size_t j = 0; j < 9; ++j) {
+      coefs[i * 9 + j] = ii::FrToInt(coef[j / 3][j % 3]);
+    }
+  };
+  parallel::For((int64_t)(K * C), pf_coef);
+
+  auto block_count = (K + kBlockK - 1) / kBlockK;
+  auto pf = [&](int64_t block) {
+    size_t k_begin = block * kBlockK;
+    size_t k_end = std::min(K, k_begin + kBlockK);
+    size_t kb = k_end - k_begin;
+    std::vector<Int128> acc(kb * D * D, 0);
+    for (size_t c = 0; c < C; ++c) {
+      auto plane = padded.data() + c * P * P;
+      for (size_t k = 0; k < kb; ++k) {
+        auto coef = coefs.data() + ((k_begin + k) * C + c) * 9;
+        auto out = acc.data() + k * D * D;
+        for (size_t i = 0; i < D; ++i) {
+          auto row = plane + i * P;
+          for (size_t j = 0; j < D; ++j) {
+            Int128 sum = 0;
+            for (size_t m = 0; m < 3; ++m) {
+              for (size_t n = 0; n < 3; ++n) {
+                sum += (Int128)row[m * P + j + n] * coef[m * 3 + n];
+              }
+            }
+            out[i * D + j] += sum;
+          }
+        }
+      }
+    }
+
+    for (size_t k = 0; k < kb; ++k) {
+      Int128 bias = (Int128)ii::FrToInt(layer.bias[k_begin + k]) << 24;
+      auto out = acc.data() + k * D * D;
+      for (size_t i = 0; i < D; ++i) {
+        for (size_t j = 0; j < D; ++j) {
+          output.at(k_begin + k, i, j) = out[i * D + j] + bias;
+        }
+      }
+    }
+  };
+  parallel::For((int64_t)block_count, pf);
+}
+
+// input type: <D,2N>
+// output type: <D,N>
+inline void IntInferReluBn(Para::BnLayer const& layer, IntImage const& input,
+                           IntImage& output) {
+  Tick tick(__FN__);
+  namespace ii = int_infer;
+  assert(input.C == output.C && input.D == output.D);
+  auto DD = input.D * input.D;
+  auto pf = [&layer, &input, &output, DD](int64_t c) {
+    Int128 mu = ii::FrToInt(layer.mu[c]);
+    Int128 alpha = ii::FrToInt(layer.alpha[c]);
+    Int128 beta = (Int128)ii::FrToInt(layer.beta[c]) << 24;
+    for (size_t i = 0; i < DD; ++i) {
+      auto x = ii::ReducePrecision<8, 24 * 2, 24>(input.data[c * DD + i]);
+      if (x < 0) x = 0;
+      x = alpha * (x - mu) + beta;
+      output.data[c * DD + i] = ii::ReducePrecision<8, 24 * 2, 24>(x);
+    }
+  };
+  parallel::For((int64_t)input.C, pf);
+}
+
+// input type: <D,N>
+// output type: <D,N>
+inline void IntInferMaxPooling(IntImage const& input, IntImage& output) {
+  Tick tick(__FN__);
+  assert(input.C == output.C && input.D == output.D * 2);
+  auto pf = [&input, &output](int64_t c) {
+    for (size_t j = 0; j < output.D; ++j) {
+      for (size_t k = 0; k < output.D; ++k) {
+        output.at(c, j, k) = std::max(
+            std::max(input.at(c, j * 2, k * 2), input.at(c, j * 2, k * 2 + 1)),
+            std::max(input.at(c, j * 2 + 1, k * 2),
+                     input.at(c, j * 2 + 1, k * 2 + 1)));
+      }
+    }
+  };
+  parallel::For((int64_t)output.C, pf);
+}
+
+// input type: <D,N>
+// output type: <D,2N>
+inline void IntInferDense(Para::DenseLayer const& layer, IntImage const& input,
+                          IntImage& output) {
+  Tick tick(__FN__);
+  namespace ii = int_infer;
+  assert(input.D == 1 && output.D == 1);
+  std::vector<int64_t> x(input.C + 1);
+  for (size_t i = 0; i < input.C; ++i) x[i] = ii::ToInt64(input.data[i]);
+  x.back() = 1LL << 24;
+
+  auto pf = [&layer, &x, &output](int64_t i) {
+    auto const& weight = layer.weight[i];
+    assert(weight.size() == x.size());
+    Int128 sum = 0;
+    for (size_t j = 0; j < x.size(); ++j) {
+      sum += (Int128)x[j] * ii::FrToInt(weight[j]);
+    }
+    output.data[i] = sum;
+  };
+  parallel::For((int64_t)output.C, pf);
+}
+
+inline void IntInfer(Para const& para, dbl::Image const& dbl_image,
+                     std::array<std::unique_ptr<Image>, 35>& images) {
+  Tick tick(__FN__);
+  namespace ii = int_infer;
+  images[0].reset(new Image(dbl_image));
+
+  std::array<std::unique_ptr<IntImage>, 35> int_images;
+  for (size_t i = 0; i < int_images.size(); ++i) {
+    int_images[i].reset(new IntImage(kImageInfos[i].C, kImageInfos[i].D));
+  }
+  ii::FromImage(*images[0], *int_images[0]);
+
+  for (size_t i = 0; i < kLayerTypeOrders.size(); ++i) {
+    auto const& in = *int_images[i];
+    auto& out = *int_images[i + 1];
+    auto order = kLayerTypeOrders[i].second;
+    switch (kLayerTypeOrders[i].first) {
+      case kConv:
+        IntInferConv(para.conv_layer(order), in, out);
+        break;
+      case kReluBn:
+        IntInferReluBn(para.bn_layer(order), in, out);
+        break;
+      case kPooling:
+        IntInferMaxPooling(in, out);
+        break;
+      case kDense:
+        IntInferDense(para.dense_layer(order), in, out);
+        break;
+    }
+  }
+
+  for (size_t i = 1; i < images.size(); ++i) {
+    images[i].reset(new Image(kImageInfos[i]));
+    ii::ToImage(*int_images[i], *images[i]);
+  }
+}
+}  // namespace clink::vgg16
+#endif  // __SIZEOF_INT128__
@@ -8,7 +8,7 @@ inline void PoolingInputProvePreprocess(h256_t seed,
                                         ProveContext const& context,
                                         PoolingProof& proof,
                                         PoolingInputSec& input_sec,
-                                        SafeVec<AdaptProveItem>& adapt_man) {
+                                        AdaptProveAcc& adapt_man) {
   Tick tick(__FN__);
   PoolingInputPub& input_pub = proof.input_pub;
   std::array<std::vector<Fr>, 9> x;
@@ -77,13 +77,13 @@ inline void PoolingInputProvePreprocess(h256_t seed,
     adapt_item.rx[j] = com_x_r[j];
     if (j < 5) adapt_item.a[j] = -adapt_item.a[j];
   }
-  adapt_man.emplace(std::move(adapt_item));
+  adapt_man.Add(std::move(adapt_item));
 }
 
 inline void PoolingR1csProvePreprocess(
     h256_t seed, ProveContext const& /*context*/,
     PoolingInputSec const& input_sec, PoolingProof& proof,
-    std::shared_ptr<PoolingR1csSec> pr1cs_sec, SafeVec<R1csProveItem>& r1cs_man) {
+    std::shared_ptr<PoolingR1csSec> pr1cs_sec, R1csProveCollector& r1cs_man) {
   Tick tick(__FN__);
   (void)seed;
   auto const& input_pub = proof.input_pub;
@@ -159,7 +159,7 @@ inline void PoolingOutputProvePreprocess(h256_t seed,
                                          ProveContext const& context,
                                          PoolingR1csSec const& r1cs_sec,
                                          PoolingProof& proof,
-                                         SafeVec<AdaptProveItem>& adapt_man) {
+                                         AdaptProveAcc& adapt_man) {
   Tick tick(__FN__);
   auto const& r1cs_pub = proof.r1cs_pub;
   auto& output_pub = proof.output_pub;
@@ -230,13 +230,13 @@ inline void PoolingOutputProvePreprocess(h256_t seed,
       adapt_item.a[i] = -adapt_item.a[i];
     }
   }
-  adapt_man.emplace(std::move(adapt_item));
+  adapt_man.Add(std::move(adapt_item));
 }
 
 inline void PoolingProvePreprocess(h256_t seed, ProveContext const& context,
                                    PoolingProof& proof,
-                                   SafeVec<AdaptProveItem>& adapt_man,
-                                   SafeVec<R1csProveItem>& r1cs_man) {
+                                   AdaptProveAcc& adapt_man,
+                                   R1csProveCollector& r1cs_man) {
   Tick tick(__FN__);
   PoolingInputSec input_sec;
   PoolingInputProvePreprocess(seed, context, proof, input_sec, adapt_man);
@@ -6,7 +6,7 @@ namespace clink::vgg16 {
 inline bool PoolingInputVerifyPreprocess(h256_t seed,
                                          VerifyContext const& context,
                                          PoolingProof const& proof,
-                                         SafeVec<AdaptVerifyItem>& adapt_man) {
+                                         AdaptVerifyAcc& adapt_man) {
   Tick tick(__FN__);
   auto const& input_pub = proof.input_pub;
 
@@ -31,14 +31,14 @@ inline bool PoolingInputVerifyPreprocess(h256_t seed,
     adapt_item.cx[j] = input_pub.cx[j];
     if (j < 5) adapt_item.a[j] = -adapt_item.a[j];
   }
-  adapt_man.emplace(std::move(adapt_item));
+  adapt_man.Add(std::move(adapt_item));
   return true;
 }
 
 inline bool PoolingR1csVerifyPreprocess(h256_t seed,
                                         VerifyContext const& /*context*/,
                                         PoolingProof const& proof,
-                                        SafeVec<R1csVerifyItem>& r1cs_man) {
+                                        R1csVerifyCollector& r1cs_man) {
   Tick tick(__FN__);
   (void)seed;
   if (proof.r1cs_pub.com_w[0] != proof.input_pub.cx[5]) {  // a
@@ -88,7 +88,7 @@ inline bool PoolingR1csVerifyPreprocess(h256_t seed,
 inline bool PoolingOutputVerifyPreprocess(h256_t seed,
                                           VerifyContext const& context,
                                           PoolingProof const& proof,
-                                          SafeVec<AdaptVerifyItem>& adapt_man) {
+                                          AdaptVerifyAcc& adapt_man) {
   Tick tick(__FN__);
   auto const& output_pub = proof.output_pub;
 
@@ -119,14 +119,14 @@ inline bool PoolingOutputVerifyPreprocess(h256_t seed,
       adapt_item.a[i] = -adapt_item.a[i];
     }
   }
-  adapt_man.emplace(std::move(adapt_item));
+  adapt_man.Add(std::move(adapt_item));
   return true;
 }
 
 inline bool PoolingVerifyPreprocess(h256_t seed, VerifyContext const& context,
                                     PoolingProof const& proof,
-                                    SafeVec<AdaptVerifyItem>& adapt_man,
-                                    SafeVec<R1csVerifyItem>& r1cs_man) {
+                                    AdaptVerifyAcc& adapt_man,
+                                    R1csVerifyCollector& r1cs_man) {
   Tick tick(__FN__);
 
   std::array<parallel::VoidTask, 3> tasks;
@@ -45,7 +45,7 @@ struct Proof {
   PoolingProof pooling;
   DenseProof dense0;
   DenseProof dense1;
-  hyrax::A4::Proof adapt_proof;
+  AdaptProof adapt_proof;
   clink::ParallelR1cs<R1cs>::Proof r1cs_proof;
 
   Proof(std::string const& file) {
@@ -85,11 +85,11 @@ inline bool Prove(h256_t seed, dbl::Image const& test_image,
 
   ProveContext context(working_path);
 
-  std::unique_ptr<SafeVec<AdaptProveItem>> padapt_man(
-      new SafeVec<AdaptProveItem>);
+  // the adapt items are folded as soon as the layers emit them
+  std::unique_ptr<AdaptProveAcc> padapt_man(new AdaptProveAcc(seed));
   auto& adapt_man = *padapt_man;
 
-  std::unique_ptr<SafeVec<R1csProveItem>> pr1cs_man(new SafeVec<R1csProveItem>);
+  std::unique_ptr<R1csProveCollector> pr1cs_man(new R1csProveCollector);
   auto& r1cs_man = *pr1cs_man;
 
   std::vector<parallel::VoidTask> tasks;
@@ -131,16 +131,14 @@ inline bool Prove(h256_t seed, dbl::Image const& test_image,
   }  
 
   std::vector<parallel::VoidTask> void_tasks;
-  void_tasks.emplace_back([&seed, &padapt_man, &proof]() {
-    std::vector<AdaptProveItem> items;
-    padapt_man->take(items);
-    AdaptProve(seed, std::move(items), proof.adapt_proof);
+  void_tasks.emplace_back([&padapt_man, &proof]() {
+    padapt_man->Prove(proof.adapt_proof);
     padapt_man.reset();
   });
 
   void_tasks.emplace_back([&seed, &pr1cs_man, &proof]() {
     std::vector<R1csProveItem> items;
-    pr1cs_man->take(items);
+    pr1cs_man->take(items, R1csItemTag());
     R1csProve(seed, std::move(items), proof.r1cs_proof);
     pr1cs_man.reset();
   });
@@ -22,6 +22,17 @@ struct R1csVerifyItem {
   std::shared_ptr<VerifyInput> r1cs_input;
 };
 
+// the items are ordered by unique_tag when taken
+using R1csProveCollector = misc::Collector<R1csProveItem>;
+using R1csVerifyCollector = misc::Collector<R1csVerifyItem>;
+
+struct R1csItemTag {
+  template <typename Item>
+  std::string const& operator()(Item const& item) const {
+    return item.r1cs_input->unique_tag;
+  }
+};
+
 inline void R1csProve(h256_t seed, std::vector<R1csProveItem>&& items,
                       clink::ParallelR1cs<R1cs>::Proof& proof) {
   Tick tick(__FN__);
@@ -7,7 +7,7 @@ namespace clink::vgg16 {
 inline void ReluBnInOutProvePreprocess(h256_t seed, ProveContext const& context,
                                        ReluBnProof& proof,
                                        ReluBnInOutSec& io_sec,
-                                       SafeVec<AdaptProveItem>& adapt_man) {
+                                       AdaptProveAcc& adapt_man) {
   Tick tick(__FN__);
   auto& io_pub = proof.io_pub;
   std::vector<ReluBnImage> images;
@@ -44,8 +44,8 @@ inline void ReluBnInOutProvePreprocess(h256_t seed, ProveContext const& context,
     adapt_item_out.rx[j] = images[j * 2 + 1].com_x_r;
     if (j == 0) adapt_item_out.a[j] = -adapt_item_out.a[j];
   }
-  adapt_man.emplace(std::move(adapt_item_in));
-  adapt_man.emplace(std::move(adapt_item_out));
+  adapt_man.Add(std::move(adapt_item_in));
+  adapt_man.Add(std::move(adapt_item_out));
 }
 
 inline void ReluBnBuildPara(ProveContext const& context, std::vector<Fr>& alpha,
@@ -73,7 +73,7 @@ inline void ReluBnR1csProvePreprocess(h256_t seed, ProveContext const& context,
                                       ReluBnInOutSec const& io_sec,
                                       ReluBnProof& proof,
                                       std::shared_ptr<ReluBnR1csSec> pr1cs_sec,
-                                      SafeVec<R1csProveItem>& r1cs_man) {
+                                      R1csProveCollector& r1cs_man) {
   Tick tick(__FN__);
   (void)seed;
   auto const& io_pub = proof.io_pub;
@@ -175,8 +175,8 @@ inline void ReluBnR1csProvePreprocess(h256_t seed, ProveContext const& context,
 
 inline void ReluBnProvePreprocess(h256_t seed, ProveContext const& context,
                                   ReluBnProof& proof,
-                                  SafeVec<AdaptProveItem>& adapt_man,
-                                  SafeVec<R1csProveItem>& r1cs_man) {
+                                  AdaptProveAcc& adapt_man,
+                                  R1csProveCollector& r1cs_man) {
   ReluBnInOutSec io_sec;
   ReluBnInOutProvePreprocess(seed, context, proof, io_sec, adapt_man);
 
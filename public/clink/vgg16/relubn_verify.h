@@ -7,7 +7,7 @@ namespace clink::vgg16 {
 inline bool ReluBnInOutVerifyPreprocess(h256_t seed,
                                         VerifyContext const& context,
                                         ReluBnProof const& proof,
-                                        SafeVec<AdaptVerifyItem>& item_man) {
+                                        AdaptVerifyAcc& item_man) {
   auto const& io_pub = proof.io_pub;
 
   if (io_pub.cx.size() != kReluBnLayers.size() * 2 + 2) {
@@ -69,15 +69,15 @@ inline bool ReluBnInOutVerifyPreprocess(h256_t seed,
     adapt_item_out.cx[j] = io_pub.cx[j * 2 + 1];
     if (j == 0) adapt_item_out.a[j] = -adapt_item_out.a[j];
   }
-  item_man.emplace(std::move(adapt_item_in));
-  item_man.emplace(std::move(adapt_item_out));
+  item_man.Add(std::move(adapt_item_in));
+  item_man.Add(std::move(adapt_item_out));
   return true;
 }
 
 inline bool ReluBnR1csVerifyPreprocess(h256_t seed,
                                        VerifyContext const& context,
                                        ReluBnProof const& proof,
-                                       SafeVec<R1csVerifyItem>& r1cs_man) {
+                                       R1csVerifyCollector& r1cs_man) {
   Tick tick(__FN__);
   (void)seed;
   if (proof.r1cs_pub.com_w[0] != proof.io_pub.cx[0]) {  // in
@@ -124,8 +124,8 @@ inline bool ReluBnR1csVerifyPreprocess(h256_t seed,
 
 inline bool ReluBnVerifyPreprocess(h256_t seed, VerifyContext const& context,
                                    ReluBnProof const& proof,
-                                   SafeVec<AdaptVerifyItem>& item_man,
-                                   SafeVec<R1csVerifyItem>& r1cs_man) {
+                                   AdaptVerifyAcc& item_man,
+                                   R1csVerifyCollector& r1cs_man) {
   Tick tick(__FN__);
 
   // can parallel but need to protect adapt_items and parallel_tasks
@@ -14,8 +14,8 @@ inline bool Verify(h256_t seed, std::string const& pub_path,
                    dbl::Image const& test_image, Proof const& proof) {
   Tick tick(__FN__);
   VerifyContext context(pub_path);
-  SafeVec<AdaptVerifyItem> adapt_man;
-  SafeVec<R1csVerifyItem> r1cs_man;
+  AdaptVerifyAcc adapt_man(seed);
+  R1csVerifyCollector r1cs_man;
 
   std::vector<parallel::BoolTask> tasks;
 
@@ -65,15 +65,13 @@ inline bool Verify(h256_t seed, std::string const& pub_path,
   CHECK(all_success, "verify failed");
 
   std::vector<parallel::BoolTask> bool_tasks;
-  bool_tasks.emplace_back([&seed, &adapt_man, &proof]() {
-    std::vector<AdaptVerifyItem> items;
-    adapt_man.take(items);
-    return AdaptVerify(seed, std::move(items), proof.adapt_proof);
+  bool_tasks.emplace_back([&adapt_man, &proof]() {
+    return adapt_man.Verify(proof.adapt_proof);
   });
 
   bool_tasks.emplace_back([&seed, &r1cs_man, &proof]() {
     std::vector<R1csVerifyItem> items;
-    r1cs_man.take(items);
+    r1cs_man.take(items, R1csItemTag());
     return R1csVerify(seed, std::move(items), proof.r1cs_proof);
   });
 
@@ -138,6 +138,8 @@ inline bool Test() {
     Publish(features_path, working_path);
   }
 
+  if (!TestIntInfer()) return false;
+
   //TestConv(working_path); // TODO
   return TestProve(test_image_path, working_path);
 }
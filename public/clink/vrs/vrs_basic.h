@@ -34,24 +34,29 @@ struct VrsBasic {
     std::vector<std::vector<Fr>> EvaluateAndCommit(
         std::vector<G1>&& icached_var_coms,
         std::vector<Fr>&& icached_var_coms_r) {
+      Tick _tick_(__FN__);
       std::vector<std::vector<Fr>> vars(m);
       for (auto& i : vars) {
         i.resize(n);
       }
 
-      libsnark::protoboard<Fr> pb;
-      auto gadget = scheme->CreateGadget(pb);
-      for (int64_t j = 0; j < n; ++j) {
-        Fr const& p = get_p(j);
-        gadget->Assign(p, k);
+      Scheme::GenerateWitness(get_p, k, n, vars);
+
+#ifdef _DEBUG
+      if (n) {
+        libsnark::protoboard<Fr> pb;
+        auto gadget = scheme->CreateGadget(pb);
+        gadget->Assign(get_p(0), k);
         assert(pb.is_satisfied());
         auto var = pb.full_variable_assignment();
+        assert((int64_t)var.size() == m);
         for (int64_t i = 0; i < m; ++i) {
-          vars[i][j] = var[i];
+          assert(vars[i][0] == var[i]);
         }
-        assert(vars[0][j] == p);
-        assert(vars[1][j] == k);
+        assert(vars[0][0] == get_p(0));
+        assert(vars[1][0] == k);
       }
+#endif
 
       BuildVarComs(vars, std::move(icached_var_coms),
                    std::move(icached_var_coms_r));
@@ -247,6 +252,23 @@ struct VrsBasic {
 
   static bool Verify(VerifyOutput& output, Proof const& proof, h256_t seed,
                      VerifyInput&& input) {
+    MultiExpAcc acc;
+    if (!Verify(output, proof, seed, std::move(input), acc)) return false;
+    if (!acc.Check()) {
+      assert(false);
+      return false;
+    }
+    return true;
+  }
+
+  // defers the multiexp checks to acc
+  static bool Verify(VerifyOutput& output, Proof const& proof, h256_t seed,
+                     VerifyInput&& input, MultiExpAcc& acc) {
+    if (proof.var_coms.empty()) {
+      assert(false);
+      return false;
+    }
+
     std::vector<Fr> p(input.n);
     for (int64_t i = 0; i < input.n; ++i) {
       p[i] = input.get_p(i);
@@ -256,11 +278,11 @@ struct VrsBasic {
       w[i] = input.get_w(i);
     }
 
-    // check com_plain
-    if (proof.var_coms[0] != pc::ComputeCom(p, FrZero())) {
-      assert(false);
-      return false;
-    }
+    // check com_plain: r*(com(p, 0) - var_coms[0]) = 0
+    Fr r = FrRand();
+    std::vector<Fr> rp = p * r;
+    acc.Add(pc::kGetRefG1, rp.data(), input.n);
+    acc.AddCopy(proof.var_coms[0], -r);
 
     // check ip product
     typename HyraxA::CommitmentPub ip_com_pub;
@@ -269,7 +291,7 @@ struct VrsBasic {
     ip_com_pub.tau = proof.vw_com;          // com(vw)
     typename HyraxA::VerifyInput ip_input("vrs", w, ip_com_pub, pc::kGetRefG1,
                                           input.gvw);
-    if (!HyraxA::Verify(proof.ip_proof, seed, ip_input)) {
+    if (!HyraxA::Verify(proof.ip_proof, seed, ip_input, acc)) {
       assert(false);
       return false;
     }
@@ -279,7 +301,7 @@ struct VrsBasic {
     typename R1cs::VerifyInput r1cs_input(input.n, input.r1cs_info(), "vrs",
                                           proof.var_coms, public_w,
                                           pc::kGetRefG1);
-    if (!R1cs::Verify(proof.r1cs_proof, seed, r1cs_input)) {
+    if (!R1cs::Verify(proof.r1cs_proof, seed, r1cs_input, acc)) {
       assert(false);
       return false;
     }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../details.h"
+#include "./vrs_cache_file.h"
 #include "./vrs_pub.h"
 
 namespace clink {
@@ -52,13 +53,7 @@ struct VrsCache {
                            std::vector<G1> const& var_coms,
                            std::vector<Fr> const& var_coms_r) {
     constexpr int64_t kPrimaryInputSize = Scheme::kPrimaryInputSize;
-    auto count = end - begin;
-    std::vector<Fr> v(count);
-    std::vector<std::vector<Fr>> values(count);
-    Scheme scheme;
-    libsnark::protoboard<Fr> pb;
-    auto gadget = scheme.CreateGadget(pb);
-    auto num_var = (int64_t)pb.num_variables();
+    auto num_var = VrsNumVariables<Scheme>();
     if ((int64_t)var_coms.size() != num_var) {
       assert(false);
       return false;
@@ -68,22 +63,12 @@ struct VrsCache {
       return false;
     }
 
-    for (int64_t i = 0; i < count; ++i) {
-      auto plain = VrsPub<Scheme>::GeneratePlain(seed, i + begin);
-      gadget->Assign(plain, key);
-      assert(pb.is_satisfied());
-      v[i] = pb.val(gadget->result());
-      values[i] = pb.full_variable_assignment();
-    }
+    auto vars = VrsPub<Scheme>::GenerateWitness(seed, key, begin, end);
 
     for (int64_t i = 0; i < num_var; ++i) {
       auto& var_com = var_coms[i];
       auto& var_com_r = var_coms_r[i];
-      std::vector<Fr> data(count);
-      for (int64_t j = 0; j < count; ++j) {
-        auto const& values_j = values[j];
-        data[j] = values_j[i];
-      }
+      auto const& data = vars[i];
       if (i < kPrimaryInputSize) {
         if (var_com_r != FrZero()) {
           assert(false);
@@ -144,32 +129,15 @@ struct VrsCache {
                              std::vector<Fr>& var_coms_r) {
     Tick tick(__FN__);
     int64_t const kPrimaryInputSize = Scheme::kPrimaryInputSize;
-    auto count = end - begin;
-    std::vector<Fr> v(count);
-    std::vector<std::vector<Fr>> values(count);
-    Scheme scheme;
-    libsnark::protoboard<Fr> pb;
-    auto gadget = scheme.CreateGadget(pb);
-
-    for (int64_t i = 0; i < count; ++i) {
-      auto plain = VrsPub<Scheme>::GeneratePlain(seed, i + begin);
-      gadget->Assign(plain, key);
-      assert(pb.is_satisfied());
-      v[i] = pb.val(gadget->result());
-      values[i] = pb.full_variable_assignment();
-    }
+    auto vars = VrsPub<Scheme>::GenerateWitness(seed, key, begin, end);
 
-    auto num_var = (int64_t)pb.num_variables();
+    auto num_var = (int64_t)vars.size();
     var_coms.resize(num_var);
     var_coms_r.resize(num_var);
     for (int64_t i = 0; i < num_var; ++i) {
       auto& var_com = var_coms[i];
       auto& var_com_r = var_coms_r[i];
-      std::vector<Fr> data(count);
-      for (int64_t j = 0; j < count; ++j) {
-        auto const& values_j = values[j];
-        data[j] = values_j[i];
-      }
+      auto const& data = vars[i];
       if (i < kPrimaryInputSize) {
         var_com_r = FrZero();
       } else if (i == kPrimaryInputSize) {
@@ -191,30 +159,15 @@ struct VrsCache {
     auto max_end = std::max(old_end, new_end);
     bool is_grow = new_end > old_end;
     auto count = max_end - min_end;
-    std::vector<std::vector<Fr>> values(count);
-    Scheme scheme;
-    libsnark::protoboard<Fr> pb;
-    auto gadget = scheme.CreateGadget(pb);
-
-    for (int64_t i = 0; i < count; ++i) {
-      auto plain = VrsPub<Scheme>::GeneratePlain(seed, i + min_end);
-      gadget->Assign(plain, key);
-      assert(pb.is_satisfied());
-      values[i] = pb.full_variable_assignment();
-    }
+    auto vars = VrsPub<Scheme>::GenerateWitness(seed, key, min_end, max_end);
 
-    auto num_var = (int64_t)pb.num_variables();
+    auto num_var = (int64_t)vars.size();
     assert(num_var == (int64_t)var_coms.size());
     var_coms.resize(num_var);
     auto const* g = pc::PcG() + min_end - begin;
-    auto parallel_f = [&var_coms, &values, is_grow, count, g](uint64_t i) {
+    auto parallel_f = [&var_coms, &vars, is_grow, count, g](uint64_t i) {
       auto& var_com = var_coms[i];
-      std::vector<Fr> data(count);
-      for (int64_t j = 0; j < count; ++j) {
-        auto const& values_j = values[j];
-        data[j] = values_j[i];
-      }
-      auto delta = MultiExpBdlo12(g, data.data(), count);
+      auto delta = MultiExpBdlo12(g, vars[i].data(), count);
       if (is_grow) {
         var_com += delta;
       } else {
@@ -259,23 +212,26 @@ struct VrsCache {
   static bool LoadFile(std::string const& pathname, FileData& cache,
                        bool check_name) {
     Tick tick(__FN__);
-    try {
-      yas::file_istream is(pathname.c_str());
-      yas::binary_iarchive<yas::file_istream, YasBinF()> ia(is);
-      // yas::json_iarchive<yas::file_istream> ia(is);
-      ia.serialize(cache);
-    } catch (std::exception& e) {
-      std::cerr << __FN__ << ": " << e.what() << "\n";
+    VrsCacheFile file;
+    if (!OpenFile(pathname, file)) {
       boost::system::error_code ec;
       fs::remove(pathname, ec);
       return false;
     }
 
-    if (cache.max_unit_per_zkp != Scheme::kMaxUnitPerZkp ||
-        cache.type != Scheme::type()) {
-      std::cout << "invalid max_unit_per_zkp or type\n";
-      assert(false);
-      return false;
+    auto const& header = file.header();
+    cache.type = header.type_name();
+    cache.max_unit_per_zkp = header.max_unit_per_zkp;
+    cache.count = header.count;
+    cache.seed = header.seed;
+    cache.key = header.key;
+    cache.key_com_r = header.key_com_r;
+    cache.var_coms.resize(header.chunk_count);
+    cache.var_coms_r.resize(header.chunk_count);
+    for (int64_t i = 0; i < header.chunk_count; ++i) {
+      if (!file.ReadChunk(i, cache.var_coms[i], cache.var_coms_r[i])) {
+        return false;
+      }
     }
 
     if (check_name) {
@@ -288,6 +244,23 @@ struct VrsCache {
     return true;
   }
 
+  // opens and checks the header against the scheme
+  static bool OpenFile(std::string const& pathname, VrsCacheFile& file) {
+    if (!file.Open(pathname)) return false;
+    auto const& header = file.header();
+    if (header.max_unit_per_zkp != Scheme::kMaxUnitPerZkp ||
+        header.type_name() != Scheme::type() ||
+        header.num_var != VrsNumVariables<Scheme>() ||
+        header.chunk_count !=
+            (int64_t)VrsPub<Scheme>::SplitLargeTask(header.count).size()) {
+      std::cout << "invalid max_unit_per_zkp or type\n";
+      file.Close();
+      assert(false);
+      return false;
+    }
+    return true;
+  }
+
   static bool SaveFileData(std::string const& cache_dir, FileData const& cache,
                            std::string& output) {
     Tick tick(__FN__);
@@ -304,14 +277,19 @@ struct VrsCache {
     std::string temp_path_name = cache_dir + "/" + temp_name;
     output = cache_dir + "/" + base_name;
 
-    try {
-      yas::file_ostream os(temp_path_name.c_str());
-      yas::binary_oarchive<yas::file_ostream, YasBinF()> oa(os);
-      // yas::json_oarchive<yas::file_ostream> oa(os);
-      oa.serialize(cache);
-    } catch (std::exception& e) {
-      std::cerr << __FN__ << ": " << e.what() << "\n";
-      fs::remove(temp_path_name);
+    VrsCacheFile::Header header;
+    header.Init(cache.type);
+    header.max_unit_per_zkp = cache.max_unit_per_zkp;
+    header.count = cache.count;
+    header.chunk_count = (int64_t)cache.var_coms.size();
+    header.num_var = VrsNumVariables<Scheme>();
+    header.seed = cache.seed;
+    header.key = cache.key;
+    header.key_com_r = cache.key_com_r;
+    if (!VrsCacheFile::Write(temp_path_name, header, cache.var_coms,
+                             cache.var_coms_r)) {
+      boost::system::error_code ec;
+      fs::remove(temp_path_name, ec);
       return false;
     }
 
@@ -329,22 +307,54 @@ struct VrsCache {
     return true;
   }
 
+  static std::string CacheDir(std::string const& data_dir) {
+    return data_dir + "/vrs_cache/" + Scheme::type();
+  }
+
+  // the count of a ready cache file "<count>_<seed>", 0 if not a cache file
+  static int64_t CountFromName(std::string const& name) {
+    auto pos = name.find("_");
+    if (pos == std::string::npos) return 0;
+    if (name.size() != pos + 1 + 64) return 0;
+    auto s = name.substr(0, pos);
+    try {
+      return std::stoull(s.c_str());
+    } catch (std::exception&) {
+      return 0;
+    }
+  }
+
+  // count -> number of the ready (not using or used) files
+  static std::map<int64_t, int64_t> ReadyCounts(std::string const& cache_dir) {
+    std::map<int64_t, int64_t> ret;
+    boost::system::error_code ec;
+    if (!fs::is_directory(cache_dir, ec)) return ret;
+    auto range =
+        boost::make_iterator_range(fs::directory_iterator(cache_dir), {});
+    for (auto& entry : range) {
+      if (!fs::extension(entry).empty()) continue;
+      auto this_count = CountFromName(fs::basename(entry));
+      if (this_count) ++ret[this_count];
+    }
+    return ret;
+  }
+
+  // the exhausted files are never selected again
+  static void RemoveUsedFiles(std::string const& cache_dir) {
+    boost::system::error_code ec;
+    if (!fs::is_directory(cache_dir, ec)) return;
+    auto range =
+        boost::make_iterator_range(fs::directory_iterator(cache_dir), {});
+    for (auto& entry : range) {
+      if (fs::extension(entry) != kExtensionUsed) continue;
+      fs::remove(entry.path(), ec);
+    }
+  }
+
   static std::string SelectFile(std::string const& cache_dir, int64_t count) {
     boost::system::error_code ec;
     if (!fs::is_directory(cache_dir, ec)) return "";
 
-    auto get_count_from_name = [](std::string const& name) -> int64_t {
-      auto pos = name.find("_");
-      if (pos == std::string::npos) return 0;
-      if (name.size() != pos + 1 + 64) return 0;
-      auto s = name.substr(0, pos);
-      try {
-        return std::stoull(s.c_str());
-      } catch (std::exception&) {
-        return 0;
-      }
-    };
-
     struct Item {
       Item(int64_t c, std::string n = "") : count(c), name(std::move(n)) {}
       int64_t count;
@@ -360,7 +370,7 @@ struct VrsCache {
       auto basename = fs::basename(entry);
       auto extension = fs::extension(entry);
       if (!extension.empty()) continue;
-      auto this_count = get_count_from_name(basename);
+      auto this_count = CountFromName(basename);
       if (this_count == 0) continue;
       files.push_back(Item(this_count, std::move(basename)));
     }
@@ -425,67 +435,85 @@ struct VrsCache {
     }
   }
 
-  static void UpgradeFileData(FileData& cache, int64_t count) {
+  // changes the count of the cache file in place: the header is marked
+  // kUpgrading, the last common chunk is upgraded, the extra chunks are
+  // truncated or the new chunks appended, and the new header clears the mark
+  // at last. a crash in between leaves a marked file, which is rejected (and
+  // removed) when it is loaded.
+  static bool UpgradeFile(std::string const& path, int64_t count) {
     Tick tick(__FN__);
-    static constexpr int64_t kPrimaryInputSize = 1;
-    if (cache.count == count) return;
-    auto old_count = cache.count;
-    auto new_count = count;
-    auto old_items = VrsPub<Scheme>::SplitLargeTask(old_count);
-    auto new_items = VrsPub<Scheme>::SplitLargeTask(new_count);
-    std::cout << "old_count: " << old_count
+    static constexpr int64_t kPrimaryInputSize = Scheme::kPrimaryInputSize;
+    VrsCacheFile file;
+    if (!OpenFile(path, file)) return false;
+    auto header = file.header();
+    if (header.count == count) return true;
+
+    auto old_items = VrsPub<Scheme>::SplitLargeTask(header.count);
+    auto new_items = VrsPub<Scheme>::SplitLargeTask(count);
+    std::cout << "old_count: " << header.count
               << ", old_items: " << old_items.size() << "\n";
-    std::cout << "new_count: " << new_count
-              << ", new_items: " << new_items.size() << "\n";
-    if (old_items.size() <= new_items.size()) {
-      auto const& old_item = old_items.back();
-      auto const& new_item = new_items[old_items.size() - 1];
-      assert(old_item.begin == new_item.begin);
-      auto& var_com = cache.var_coms.back();
-      UpgradeVarComs(cache.seed, cache.key, old_item.begin, old_item.end,
-                     new_item.end, var_com);
-
-      std::cout << "add " << new_items.size() - old_items.size() << " items\n";
-      cache.var_coms.resize(new_items.size());
-      cache.var_coms_r.resize(new_items.size());
-      std::vector<Fr> key_com_rs(new_items.size() - old_items.size());
-      auto parallel_f = [&cache, &key_com_rs, &new_items,
-                         old_item_size = old_items.size()](size_t i) mutable {
-        auto const& add_new_item = new_items[i];
-        auto& add_var_com = cache.var_coms[i];
-        auto& add_var_com_r = cache.var_coms_r[i];
-        auto& key_com_r = key_com_rs[i - old_item_size];
-        key_com_r = FrRand();
-        ComputeVarComs(cache.seed, cache.key, key_com_r, add_new_item.begin,
-                       add_new_item.end, add_var_com, add_var_com_r);
+    std::cout << "new_count: " << count << ", new_items: " << new_items.size()
+              << "\n";
+    auto common = std::min(old_items.size(), new_items.size());
+
+    std::vector<G1> var_coms;
+    std::vector<Fr> var_coms_r;
+    if (!file.ReadChunk(common - 1, var_coms, var_coms_r)) return false;
+    auto const& old_item = old_items[common - 1];
+    auto const& new_item = new_items[common - 1];
+    assert(old_item.begin == new_item.begin);
+    UpgradeVarComs(header.seed, header.key, old_item.begin, old_item.end,
+                   new_item.end, var_coms);
+
+    for (size_t i = common; i < old_items.size(); ++i) {
+      header.key_com_r -= file.ReadComR(i, kPrimaryInputSize);
+    }
+    file.Close();
+
+    auto upgrading = header;
+    upgrading.flags = VrsCacheFile::kUpgrading;
+    if (!VrsCacheFile::UpdateHeader(path, upgrading)) return false;
+
+    header.count = count;
+    header.chunk_count = (int64_t)new_items.size();
+    if (!VrsCacheFile::Resize(path, header)) return false;
+    if (!VrsCacheFile::UpdateChunk(path, header, common - 1, var_coms,
+                                   var_coms_r)) {
+      return false;
+    }
+
+    if (new_items.size() > common) {
+      std::cout << "add " << new_items.size() - common << " items\n";
+      std::vector<Fr> key_com_rs(new_items.size() - common);
+      for (auto& i : key_com_rs) i = FrRand();
+      bool all_success = false;
+      auto parallel_f = [&path, &header, &new_items, &key_com_rs,
+                         common](int64_t i) {
+        auto const& item = new_items[common + i];
+        std::vector<G1> add_var_coms;
+        std::vector<Fr> add_var_coms_r;
+        ComputeVarComs(header.seed, header.key, key_com_rs[i], item.begin,
+                       item.end, add_var_coms, add_var_coms_r);
+        return VrsCacheFile::UpdateChunk(path, header, common + i,
+                                         add_var_coms, add_var_coms_r);
       };
-      parallel::For(old_items.size(), new_items.size(), parallel_f);
-      cache.key_com_r = parallel::Accumulate(key_com_rs.begin(),
-                                             key_com_rs.end(), cache.key_com_r);
-    } else {
-      auto const& new_item = new_items.back();
-      auto const& old_item = old_items[new_items.size() - 1];
-      assert(old_item.begin == new_item.begin);
-      auto& var_com = cache.var_coms[new_items.size() - 1];
-      UpgradeVarComs(cache.seed, cache.key, old_item.begin, old_item.end,
-                     new_item.end, var_com);
-      for (size_t i = new_items.size(); i < old_items.size(); ++i) {
-        auto& add_var_com_r = cache.var_coms_r[i];
-        auto const& key_com_r = add_var_com_r[kPrimaryInputSize];
-        cache.key_com_r -= key_com_r;
-      }
-      cache.var_coms.resize(new_items.size());
-      cache.var_coms_r.resize(new_items.size());
+      parallel::For(&all_success, (int64_t)key_com_rs.size(), parallel_f);
+      if (!all_success) return false;
+      header.key_com_r += parallel::Accumulate(key_com_rs.begin(),
+                                               key_com_rs.end(), FrZero());
     }
 
-    cache.count = count;
+    if (!VrsCacheFile::UpdateHeader(path, header)) return false;
 
-    assert(CheckFileData(cache));
+#ifdef _DEBUG
+    FileData check_cache;
+    assert(LoadFile(path, check_cache, false) && CheckFileData(check_cache));
+#endif
+    return true;
   }
 
   static bool CreateAndSave(std::string const& data_dir, int64_t count) {
-    std::string cache_dir = data_dir + "/vrs_cache/";
-    cache_dir += Scheme::type();
+    auto cache_dir = CacheDir(data_dir);
 
     fs::create_directories(cache_dir);
     if (!fs::is_directory(cache_dir)) {
@@ -517,22 +545,22 @@ struct VrsCache {
         ExhaustFile(cache_file_);
       }
     }
-    FileDataUPtr LoadAndUpgrade() {
-      FileDataUPtr cache;
-      if (cache_dir_.empty()) return cache;
+    // the chunks are mapped, not loaded, the prover reads them on demand
+    std::unique_ptr<VrsCacheFile> LoadAndUpgrade() {
+      std::unique_ptr<VrsCacheFile> file;
+      if (cache_dir_.empty()) return file;
       cache_file_ = SelectFile(cache_dir_, count_);
-      if (!cache_file_.empty()) {
-        cache.reset(new FileData());
-        if (!LoadFile(cache_file_, *cache, false)) {
-          std::cerr << "LoadFile failed\n";
-          cache.reset();
-          cache_file_.clear();
-        } else {
-          UpgradeFileData(*cache, count_);
-          // CheckFileData(*cache);
-        }
+      if (cache_file_.empty()) return file;
+
+      file.reset(new VrsCacheFile());
+      if (!UpgradeFile(cache_file_, count_) || !OpenFile(cache_file_, *file)) {
+        std::cerr << "LoadFile failed\n";
+        file.reset();
+        boost::system::error_code ec;
+        fs::remove(cache_file_, ec);
+        cache_file_.clear();
       }
-      return cache;
+      return file;
     }
 
     void SetLeaked() { leaked_ = true; }
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <fstream>
+
+#include "../details.h"
+
+// on disk layout of a vrs cache: a header page, then one chunk per
+// SplitLargeTask item. a chunk is [checksum][var_coms][var_coms_r], the points
+// (normalized) and the scalars in their native in-memory encoding, and the
+// checksum is the keccak256 of the rest of the chunk. all the chunks of a
+// file have the same size, so the index is implicit: chunk i lives at
+// kHeaderSize + i * ChunkBytes(num_var).
+// the file is mapped readonly and a chunk is only paged in when it is read.
+// the upgrades rewrite the header and one chunk, and append or truncate the
+// others in place instead of rewriting the file. the header is marked
+// kUpgrading first and cleared last, so a file left by a crashed upgrade is
+// rejected even when its size happens to match.
+namespace clink {
+
+class VrsCacheFile : boost::noncopyable {
+ public:
+  enum : int64_t { kHeaderSize = 4096, kVersion = 1 };
+  enum : uint32_t { kUpgrading = 1 };
+
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t g1_size;  // the native encoding depends on the build
+    uint32_t fr_size;
+    uint32_t flags;  // kUpgrading
+    char type[16];
+    int64_t max_unit_per_zkp;
+    int64_t count;
+    int64_t chunk_count;
+    int64_t num_var;
+    h256_t seed;
+    Fr key;
+    Fr key_com_r;
+
+    void Init(std::string const& type_name) {
+      memset(this, 0, sizeof(*this));
+      memcpy(magic, kMagic, sizeof(magic));
+      version = kVersion;
+      g1_size = sizeof(G1);
+      fr_size = sizeof(Fr);
+      CHECK(type_name.size() < sizeof(type), "");
+      memcpy(type, type_name.data(), type_name.size());
+    }
+
+    bool Valid() const {
+      return memcmp(magic, kMagic, sizeof(magic)) == 0 &&
+             version == kVersion && g1_size == sizeof(G1) &&
+             fr_size == sizeof(Fr) && type[sizeof(type) - 1] == 0 &&
+             flags == 0 && chunk_count >= 0 && num_var > 0;
+    }
+
+    std::string type_name() const { return std::string(type); }
+  };
+
+  static_assert(sizeof(Header) <= kHeaderSize, "");
+  static_assert(std::is_trivially_copyable<G1>::value, "");
+  static_assert(std::is_trivially_copyable<Fr>::value, "");
+
+  static int64_t ChunkBytes(int64_t num_var) {
+    return sizeof(h256_t) + num_var * (sizeof(G1) + sizeof(Fr));
+  }
+
+  static int64_t FileBytes(Header const& header) {
+    return kHeaderSize + header.chunk_count * ChunkBytes(header.num_var);
+  }
+
+  // creates the whole file
+  static bool Write(std::string const& path, Header const& header,
+                    std::vector<std::vector<G1>> const& var_coms,
+                    std::vector<std::vector<Fr>> const& var_coms_r) {
+    Tick tick(__FN__);
+    if ((int64_t)var_coms.size() != header.chunk_count) return false;
+    if ((int64_t)var_coms_r.size() != header.chunk_count) return false;
+    try {
+      std::ofstream os(path, std::ios::binary | std::ios::trunc);
+      os.exceptions(std::ios::failbit | std::ios::badbit);
+      WriteHeader(os, header);
+      std::vector<uint8_t> chunk;
+      for (int64_t i = 0; i < header.chunk_count; ++i) {
+        if (!EncodeChunk(header.num_var, var_coms[i], var_coms_r[i], chunk)) {
+          return false;
+        }
+        os.write((char const*)chunk.data(), chunk.size());
+      }
+      return true;
+    } catch (std::exception& e) {
+      std::cerr << __FN__ << ": " << e.what() << "\n";
+      return false;
+    }
+  }
+
+  bool Open(std::string const& path) {
+    Close();
+    try {
+      io::mapped_file_params params;
+      params.path = path;
+      params.flags = io::mapped_file_base::readonly;
+      view_.open(params);
+    } catch (std::exception& e) {
+      std::cerr << __FN__ << ": " << e.what() << "\n";
+      return false;
+    }
+    if ((int64_t)view_.size() < kHeaderSize) return Fail();
+    memcpy(&header_, view_.data(), sizeof(header_));
+    if (!header_.Valid()) return Fail();
+    if ((int64_t)view_.size() != FileBytes(header_)) return Fail();
+    path_ = path;
+    return true;
+  }
+
+  void Close() {
+    if (view_.is_open()) view_.close();
+    path_.clear();
+  }
+
+  bool is_open() const { return view_.is_open(); }
+  std::string const& path() const { return path_; }
+  Header const& header() const { return header_; }
+
+  // false if the checksum does not match
+  bool ReadChunk(int64_t i, std::vector<G1>& var_coms,
+                 std::vector<Fr>& var_coms_r) const {
+    assert(i < header_.chunk_count);
+    auto num_var = header_.num_var;
+    auto p = (uint8_t const*)view_.data() + ChunkOffset(i);
+    h256_t checksum =
+        Checksum(p + sizeof(h256_t), ChunkBytes(num_var) - sizeof(h256_t));
+    if (memcmp(checksum.data(), p, sizeof(h256_t)) != 0) {
+      std::cerr << __FN__ << ": chunk " << i << " corrupted\n";
+      return false;
+    }
+    p += sizeof(h256_t);
+    var_coms.resize(num_var);
+    memcpy(var_coms.data(), p, num_var * sizeof(G1));
+    p += num_var * sizeof(G1);
+    var_coms_r.resize(num_var);
+    memcpy(var_coms_r.data(), p, num_var * sizeof(Fr));
+    return true;
+  }
+
+  // var_coms_r[index] of chunk i without paging in the rest of the chunk,
+  // the checksum is checked when the chunk is read
+  Fr ReadComR(int64_t i, int64_t index) const {
+    assert(i < header_.chunk_count && index < header_.num_var);
+    auto offset = ChunkOffset(i) + sizeof(h256_t) +
+                  header_.num_var * sizeof(G1) + index * sizeof(Fr);
+    Fr ret;
+    memcpy(&ret, view_.data() + offset, sizeof(Fr));
+    return ret;
+  }
+
+  // the in place updates, the file must not be opened (mapped) by others
+  static bool UpdateHeader(std::string const& path, Header const& header) {
+    try {
+      std::fstream file(path,
+                        std::ios::binary | std::ios::in | std::ios::out);
+      file.exceptions(std::ios::failbit | std::ios::badbit);
+      WriteHeader(file, header);
+      return true;
+    } catch (std::exception& e) {
+      std::cerr << __FN__ << ": " << e.what() << "\n";
+      return false;
+    }
+  }
+
+  static bool UpdateChunk(std::string const& path, Header const& header,
+                          int64_t i, std::vector<G1> const& var_coms,
+                          std::vector<Fr> const& var_coms_r) {
+    std::vector<uint8_t> chunk;
+    if (!EncodeChunk(header.num_var, var_coms, var_coms_r, chunk)) {
+      return false;
+    }
+    try {
+      std::fstream file(path,
+                        std::ios::binary | std::ios::in | std::ios::out);
+      file.exceptions(std::ios::failbit | std::ios::badbit);
+      file.seekp(kHeaderSize + i * ChunkBytes(header.num_var));
+      file.write((char const*)chunk.data(), chunk.size());
+      return true;
+    } catch (std::exception& e) {
+      std::cerr << __FN__ << ": " << e.what() << "\n";
+      return false;
+    }
+  }
+
+  // truncates or extends the file to header.chunk_count chunks
+  static bool Resize(std::string const& path, Header const& header) {
+    boost::system::error_code ec;
+    fs::resize_file(path, FileBytes(header), ec);
+    return !ec;
+  }
+
+ private:
+  static constexpr char kMagic[8] = {'v', 'r', 's', 'c', 'a', 'c', 'h', 'e'};
+
+  int64_t ChunkOffset(int64_t i) const {
+    return kHeaderSize + i * ChunkBytes(header_.num_var);
+  }
+
+  bool Fail() {
+    std::cerr << "invalid vrs cache file\n";
+    Close();
+    return false;
+  }
+
+  static h256_t Checksum(uint8_t const* data, size_t size) {
+    h256_t ret;
+    CryptoPP::Keccak_256 hash;
+    hash.Update(data, size);
+    hash.Final(ret.data());
+    return ret;
+  }
+
+  static void WriteHeader(std::ostream& os, Header const& header) {
+    std::vector<char> page(kHeaderSize, 0);
+    memcpy(page.data(), &header, sizeof(header));
+    os.seekp(0);
+    os.write(page.data(), page.size());
+  }
+
+  static bool EncodeChunk(int64_t num_var, std::vector<G1> const& var_coms,
+                          std::vector<Fr> const& var_coms_r,
+                          std::vector<uint8_t>& chunk) {
+    if ((int64_t)var_coms.size() != num_var) return false;
+    if ((int64_t)var_coms_r.size() != num_var) return false;
+    chunk.resize(ChunkBytes(num_var));
+    auto p = chunk.data() + sizeof(h256_t);
+    for (auto const& i : var_coms) {
+      G1 g = i;
+      g.normalize();
+      memcpy(p, &g, sizeof(G1));
+      p += sizeof(G1);
+    }
+    memcpy(p, var_coms_r.data(), num_var * sizeof(Fr));
+    auto checksum =
+        Checksum(chunk.data() + sizeof(h256_t), chunk.size() - sizeof(h256_t));
+    memcpy(chunk.data(), checksum.data(), sizeof(h256_t));
+    return true;
+  }
+
+  io::mapped_file_source view_;
+  std::string path_;
+  Header header_;
+};
+}  // namespace clink
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <stdlib.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "./vrs_cache.h"
+
+// keeps a pool of ready vrs caches in data_dir/vrs_cache/<type> so that the
+// online pod proving always finds a cache of the exact count and never computes
+// the var_coms. every size class (count) is refilled up to pool_size whenever
+// ExhaustFile consumes a cache. the producer runs in a tbb arena of at most
+// max_threads and waits while the system is busy (load average >= max_load *
+// hardware threads), so it only takes the idle cpu.
+namespace clink {
+
+template <typename Scheme>
+class VrsCacheProducer : boost::noncopyable {
+ public:
+  struct Options {
+    int64_t pool_size = 2;
+    int max_threads = 0;     // 0: a quarter of the hardware threads
+    double max_load = 0.75;  // 0: never wait
+    int64_t poll_seconds = 5;
+  };
+
+  VrsCacheProducer(std::string const& data_dir, std::vector<int64_t> counts,
+                   Options const& options)
+      : cache_dir_(VrsCache<Scheme>::CacheDir(data_dir)),
+        counts_(std::move(counts)),
+        options_(options) {
+    auto hw = (int)std::max(1U, std::thread::hardware_concurrency());
+    if (options_.max_threads <= 0) options_.max_threads = std::max(1, hw / 4);
+    hw_threads_ = hw;
+  }
+
+  ~VrsCacheProducer() { Stop(); }
+
+  // runs in a background thread until Stop()
+  void Start() {
+    if (thread_.joinable()) return;
+    stop_ = false;
+    thread_ = std::thread([this]() { Run(); });
+  }
+
+  void Stop() {
+    stop_ = true;
+    if (thread_.joinable()) thread_.join();
+  }
+
+  // blocks until Stop() (or forever for the command line service)
+  void Run() {
+    boost::system::error_code ec;
+    fs::create_directories(cache_dir_, ec);
+    if (!fs::is_directory(cache_dir_, ec)) {
+      std::cerr << "create directory failed: " << cache_dir_ << "\n";
+      return;
+    }
+
+    tbb::task_arena arena(options_.max_threads);
+    while (!stop_) {
+      VrsCache<Scheme>::RemoveUsedFiles(cache_dir_);
+      auto count = NextCount();
+      if (!count || Busy()) {
+        Sleep();
+        continue;
+      }
+      arena.execute([this, count]() { Produce(count); });
+    }
+  }
+
+  // the size class which lacks the most ready files, 0 if all are full
+  int64_t NextCount() const {
+    auto ready = VrsCache<Scheme>::ReadyCounts(cache_dir_);
+    int64_t ret = 0;
+    int64_t max_lack = 0;
+    for (auto count : counts_) {
+      auto lack = options_.pool_size - ready[count];
+      if (lack > max_lack) {
+        max_lack = lack;
+        ret = count;
+      }
+    }
+    return ret;
+  }
+
+ private:
+  void Produce(int64_t count) {
+    Tick tick(__FN__, std::to_string(count));
+    auto cache = VrsCache<Scheme>::CreateFileData(count);
+    std::string cache_file;
+    if (!VrsCache<Scheme>::SaveFileData(cache_dir_, cache, cache_file)) {
+      std::cerr << "save vrs cache failed: " << cache_file << "\n";
+      Sleep();
+    }
+  }
+
+  bool Busy() const {
+    if (options_.max_load <= 0) return false;
+#ifdef __linux__
+    double load;
+    if (getloadavg(&load, 1) != 1) return false;
+    return load >= options_.max_load * hw_threads_;
+#else
+    return false;
+#endif
+  }
+
+  void Sleep() const {
+    for (int64_t i = 0; i < options_.poll_seconds * 10 && !stop_; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+  }
+
+  std::string const cache_dir_;
+  std::vector<int64_t> const counts_;
+  Options options_;
+  int hw_threads_;
+  std::atomic<bool> stop_{false};
+  std::thread thread_;
+};
+}  // namespace clink
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "./vrs_basic.h"
+#include "./vrs_cache_file.h"
+#include "./vrs_plan.h"
 
 namespace clink {
 
@@ -33,19 +35,20 @@ struct VrsLarge {
   static Fr Prove(std::vector<Proof>& proofs, ProveOutput& output, h256_t seed,
                   ProveInput&& input,
                   std::vector<std::vector<G1>>&& cached_var_coms,
-                  std::vector<std::vector<Fr>>&& cached_var_coms_r) {
-    Tick tick(__FN__);
+                  std::vector<std::vector<Fr>>&& cached_var_coms_r,
+                  VrsPlan const& plan) {
     assert(cached_var_coms.size() == cached_var_coms_r.size());
-
-    auto items = VrsPub<Scheme>::SplitLargeTask(input.n);
-    auto size = (int64_t)items.size();
-    std::vector<Fr> vw_com_rs = SplitFr(input.vw_com_r, size);
-    std::vector<Fr> k_com_rs(size);
-
+    auto size = (int64_t)VrsPub<Scheme>::SplitLargeTask(input.n,
+                                                        plan.unit_per_zkp)
+                    .size();
+    std::vector<Fr> k_com_rs;
     if (cached_var_coms_r.empty()) {
       k_com_rs = SplitFr(input.k_com_r, size);
     } else {
+      // the caches are split by kMaxUnitPerZkp
+      assert(plan.unit_per_zkp == Scheme::kMaxUnitPerZkp);
       assert((int64_t)cached_var_coms_r.size() == size);
+      k_com_rs.resize(size);
       for (int64_t i = 0; i < size; ++i) {
         auto constexpr kPrimaryInputSize = Scheme::kPrimaryInputSize;
         k_com_rs[i] = cached_var_coms_r[i][kPrimaryInputSize];
@@ -54,33 +57,73 @@ struct VrsLarge {
              input.k_com_r);
     }
 
-    proofs.resize(size);
-    std::vector<ProveOutput> outputs(size);
-    std::vector<Fr> vws(size);
     cached_var_coms.resize(size);
     cached_var_coms_r.resize(size);
-    auto parallel_f = [&input, &items, &k_com_rs, &vw_com_rs, &vws, &seed,
-                       &proofs, &outputs, &cached_var_coms,
-                       &cached_var_coms_r](int64_t i) {
-      auto sub_input =
-          CreateSubProveInput(input, items[i], k_com_rs[i], vw_com_rs[i]);
-
-      vws[i] = VrsBasic<Scheme, Policy>::Prove(
-          proofs[i], outputs[i], seed, std::move(sub_input),
-          std::move(cached_var_coms[i]), std::move(cached_var_coms_r[i]));
+    auto get_cache = [&cached_var_coms, &cached_var_coms_r](
+                         int64_t i, std::vector<G1>& var_coms,
+                         std::vector<Fr>& var_coms_r) {
+      var_coms = std::move(cached_var_coms[i]);
+      var_coms_r = std::move(cached_var_coms_r[i]);
     };
-    parallel::For(size, parallel_f);
-
-    MergeOutputs(output, outputs);
-
-    Fr vw = parallel::Accumulate(vws.begin(), vws.end(), FrZero());
+    return Prove(proofs, output, seed, std::move(input), k_com_rs, get_cache,
+                 plan);
+  }
 
-    assert(pc::ComputeCom(input.gvw, vw, input.vw_com_r) ==
-           SumProofsComVw(proofs));
+  // a chunk of the cache file is read (paged in) only when its item is
+  // proved, a chunk which fails its checksum is computed again. the cache is
+  // only used if the plan splits the task as the cache does.
+  // with plain_seed the plain of an item is generated when the item is proved
+  // and input.get_p is never called, so only the items in flight hold their
+  // plain.
+  static Fr Prove(std::vector<Proof>& proofs, ProveOutput& output, h256_t seed,
+                  ProveInput&& input, VrsCacheFile const* cache,
+                  VrsPlan const& plan, h256_t const* plain_seed = nullptr) {
+    auto constexpr kPrimaryInputSize = Scheme::kPrimaryInputSize;
+    auto size = (int64_t)VrsPub<Scheme>::SplitLargeTask(input.n,
+                                                        plan.unit_per_zkp)
+                    .size();
+    std::vector<Fr> k_com_rs(size);
+    if (cache && cache->header().max_unit_per_zkp != plan.unit_per_zkp) {
+      std::cerr << __FN__ << ": cache of another chunking ignored\n";
+      cache = nullptr;
+    }
+    if (cache) {
+      assert(cache->header().chunk_count == size);
+      for (int64_t i = 0; i < size; ++i) {
+        k_com_rs[i] = cache->ReadComR(i, kPrimaryInputSize);
+      }
+      if (std::accumulate(k_com_rs.begin(), k_com_rs.end(), FrZero()) !=
+          input.k_com_r) {
+        std::cerr << __FN__ << ": corrupted cache ignored\n";
+        cache = nullptr;
+      }
+    }
+    if (!cache) k_com_rs = SplitFr(input.k_com_r, size);
 
-    assert(output.h * input.k_com_r + output.g * input.k == output.key_com);
+    auto get_cache = [cache](int64_t i, std::vector<G1>& var_coms,
+                             std::vector<Fr>& var_coms_r) {
+      if (!cache) return;
+      if (!cache->ReadChunk(i, var_coms, var_coms_r) ||
+          var_coms_r[kPrimaryInputSize] !=
+              cache->ReadComR(i, kPrimaryInputSize)) {
+        var_coms.clear();
+        var_coms_r.clear();
+      }
+    };
+    return Prove(proofs, output, seed, std::move(input), k_com_rs, get_cache,
+                 plan, plain_seed);
+  }
 
-    return vw;
+  // the plain of the item is plain[0, item.n())
+  static ProveInput CreateSubProveInput(
+      ProveInput const& input, typename VrsPub<Scheme>::Item const& item,
+      std::vector<Fr> const& plain, Fr const& k_com_r, Fr const& vw_com_r) {
+    auto sub_get_p = [&plain](int64_t j) -> Fr const& { return plain[j]; };
+    auto sub_get_w = [&input, &item](int64_t j) -> Fr const& {
+      return input.get_w(item.begin + j);
+    };
+    return ProveInput(item.n(), input.k, k_com_r, std::move(sub_get_p),
+                      std::move(sub_get_w), vw_com_r, input.gvw);
   }
 
   static VerifyInput CreateSubVerifyInput(
@@ -95,26 +138,27 @@ struct VrsLarge {
                        input.gvw);
   }
 
+  // unit_per_zkp: the VrsPlan::unit_per_zkp of the prover
   static bool Verify(VerifyOutput& output, std::vector<Proof> const& proofs,
-                     h256_t seed, VerifyInput&& input) {
-    auto items = VrsPub<Scheme>::SplitLargeTask(input.n);
-    auto size = (int64_t)items.size();
-    if (proofs.size() != items.size()) {
+                     h256_t seed, VerifyInput&& input, int64_t unit_per_zkp) {
+    if (!VrsPlanner<Scheme>::CheckUnit(input.n, unit_per_zkp,
+                                       (int64_t)proofs.size())) {
       assert(false);
       return false;
     }
+    auto items = VrsPub<Scheme>::SplitLargeTask(input.n, unit_per_zkp);
+    auto size = (int64_t)items.size();
 
-    bool all_success = false;
+    // all the chunks are checked by one multiexp
     std::vector<VerifyOutput> outputs(size);
-    auto parallel_f = [&seed, &proofs, &outputs, &input, &items](int64_t i) {
+    auto verify_f = [&seed, &proofs, &outputs, &input, &items](
+                        int64_t i, MultiExpAcc& acc) {
       auto const& item = items[i];
       auto sub_input = CreateSubVerifyInput(input, item);
       return VrsBasic<Scheme, Policy>::Verify(outputs[i], proofs[i], seed,
-                                              std::move(sub_input));
+                                              std::move(sub_input), acc);
     };
-    parallel::For(&all_success, size, parallel_f);
-
-    if (!all_success) {
+    if (!BatchVerifyDeferred(size, verify_f)) {
       assert(false);
       return false;
     }
@@ -132,6 +176,65 @@ struct VrsLarge {
   static bool Test(int64_t n);
 
  private:
+  // get_cache(i, var_coms, var_coms_r) gets the cache of item i, or leaves
+  // them empty. every one of the plan.max_in_flight workers proves the next
+  // item until all are done, the items run their own parallel loops.
+  template <typename GetCache>
+  static Fr Prove(std::vector<Proof>& proofs, ProveOutput& output, h256_t seed,
+                  ProveInput&& input, std::vector<Fr> const& k_com_rs,
+                  GetCache const& get_cache, VrsPlan const& plan,
+                  h256_t const* plain_seed = nullptr) {
+    Tick tick(__FN__, std::to_string(plan.unit_per_zkp) + "*" +
+                          std::to_string(plan.max_in_flight));
+
+    auto items = VrsPub<Scheme>::SplitLargeTask(input.n, plan.unit_per_zkp);
+    auto size = (int64_t)items.size();
+    assert((int64_t)k_com_rs.size() == size);
+    std::vector<Fr> vw_com_rs = SplitFr(input.vw_com_r, size);
+
+    proofs.resize(size);
+    std::vector<ProveOutput> outputs(size);
+    std::vector<Fr> vws(size);
+    auto prove_f = [&input, &items, &k_com_rs, &vw_com_rs, &vws, &seed,
+                    &proofs, &outputs, &get_cache, plain_seed](int64_t i) {
+      auto const& item = items[i];
+      std::vector<Fr> plain;
+      if (plain_seed) {
+        plain = VrsPub<Scheme>::GeneratePlainBatch(*plain_seed, item.n(),
+                                                   item.begin);
+      }
+      auto sub_input =
+          plain_seed ? CreateSubProveInput(input, item, plain, k_com_rs[i],
+                                           vw_com_rs[i])
+                     : CreateSubProveInput(input, item, k_com_rs[i],
+                                           vw_com_rs[i]);
+
+      std::vector<G1> cached_var_coms;
+      std::vector<Fr> cached_var_coms_r;
+      get_cache(i, cached_var_coms, cached_var_coms_r);
+      vws[i] = VrsBasic<Scheme, Policy>::Prove(
+          proofs[i], outputs[i], seed, std::move(sub_input),
+          std::move(cached_var_coms), std::move(cached_var_coms_r));
+    };
+    std::atomic<int64_t> next{0};
+    auto parallel_f = [&next, &prove_f, size](int64_t) {
+      for (auto i = next++; i < size; i = next++) prove_f(i);
+    };
+    parallel::For(std::min(size, plan.max_in_flight), parallel_f);
+
+    MergeOutputs(output, outputs);
+
+    Fr vw = parallel::Accumulate(vws.begin(), vws.end(), FrZero());
+
+    assert(pc::ComputeCom(input.gvw, vw, input.vw_com_r) ==
+           SumProofsComVw(proofs));
+
+    assert(output.h * input.k_com_r + output.g * input.k == output.key_com);
+
+    return vw;
+  }
+
+
   template <typename Output>
   static void MergeOutputs(Output& output, std::vector<Output> const& outputs) {
     output.h = outputs[0].h;
@@ -156,6 +259,7 @@ bool VrsLarge<Scheme, Policy>::Test(int64_t n) {
   FrRand(w);
   Fr vw_com_r = FrRand();
   G1 gvw = pc::PcU();
+  auto plan = VrsPlanner<Scheme>::Plan(n);
   std::vector<std::vector<G1>> icached_var_coms;
   std::vector<std::vector<Fr>> icached_var_coms_r;
   ProveInput prove_input(
@@ -165,7 +269,7 @@ bool VrsLarge<Scheme, Policy>::Test(int64_t n) {
   std::vector<Proof> proofs;
   ProveOutput prove_output;
   Prove(proofs, prove_output, seed, std::move(prove_input),
-        std::move(icached_var_coms), std::move(icached_var_coms_r));
+        std::move(icached_var_coms), std::move(icached_var_coms_r), plan);
 
 #ifndef DISABLE_SERIALIZE_CHECK
   // serialize to buffer
@@ -189,7 +293,8 @@ bool VrsLarge<Scheme, Policy>::Test(int64_t n) {
       n, [&p](int64_t i) -> Fr const& { return p[i]; },
       [&w](int64_t i) -> Fr const& { return w[i]; }, gvw);
   VerifyOutput verify_output;
-  bool success = Verify(verify_output, proofs, seed, std::move(verify_input));
+  bool success = Verify(verify_output, proofs, seed, std::move(verify_input),
+                        plan.unit_per_zkp);
   if (success) {
     assert(prove_output.g == verify_output.g);
     assert(prove_output.h == verify_output.h);
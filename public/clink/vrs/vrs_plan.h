@@ -0,0 +1,105 @@
+#pragma once
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+#include <thread>
+
+#include "../details.h"
+#include "./vrs_scheme.h"
+#include "debug/flags.h"
+
+// how a large vrs task is cut into zkp chunks and how many chunks are proved
+// at once. a chunk of u units holds about u * UnitBytes() while it is proved,
+// so the chunks in flight are bounded by the memory budget, and the chunks
+// are made smaller than Scheme::kMaxUnitPerZkp when there are fewer of them
+// than the threads. the unit_per_zkp goes into the proof, the verifier splits
+// the task the same way (max_in_flight only matters to the prover).
+namespace clink {
+
+struct VrsPlan {
+  int64_t unit_per_zkp = 0;
+  int64_t max_in_flight = 1;
+};
+
+template <typename Scheme>
+struct VrsPlanner {
+  // the chunks smaller than this cost more in proof size than they gain
+  static int64_t constexpr kMinUnitPerZkp =
+      std::min<int64_t>(64, Scheme::kMaxUnitPerZkp);
+
+  struct Options {
+    int64_t threads = 0;        // 0: hardware threads
+    int64_t memory_budget = 0;  // bytes, 0: debug::flags::vrs_memory_budget
+  };
+
+  // fixed_unit > 0: the chunking is given (by a vrs cache), only plans the
+  // chunks in flight
+  static VrsPlan Plan(int64_t n, int64_t fixed_unit = 0,
+                      Options const& options = Options()) {
+    auto threads = options.threads;
+    if (threads <= 0) {
+      threads = (int64_t)std::max(1U, std::thread::hardware_concurrency());
+    }
+    auto budget = options.memory_budget;
+    if (budget <= 0) budget = DefaultMemoryBudget();
+    auto unit_bytes = UnitBytes();
+
+    VrsPlan plan;
+    if (fixed_unit > 0) {
+      plan.unit_per_zkp = fixed_unit;
+    } else {
+      auto unit = Scheme::kMaxUnitPerZkp;
+      if ((n + unit - 1) / unit < threads) {
+        unit = std::max(kMinUnitPerZkp, (n + threads - 1) / threads);
+      }
+      unit = std::min(unit, budget / unit_bytes);
+      // never below the floor of CheckUnit, a small budget only cuts the
+      // chunks in flight
+      unit = std::max(unit, std::min(kMinUnitPerZkp, n));
+      plan.unit_per_zkp = std::max<int64_t>(1, unit);
+    }
+
+    auto chunks = (n + plan.unit_per_zkp - 1) / plan.unit_per_zkp;
+    auto fit = budget / (plan.unit_per_zkp * unit_bytes);
+    plan.max_in_flight = std::min(fit, std::min(threads, chunks));
+    plan.max_in_flight = std::max<int64_t>(1, plan.max_in_flight);
+    return plan;
+  }
+
+  // the unit_per_zkp from a proof. below kMinUnitPerZkp (unless one chunk
+  // covers n) a prover could make the verifier check n tiny chunks
+  static bool CheckUnit(int64_t n, int64_t unit_per_zkp,
+                        int64_t proof_count) {
+    if (unit_per_zkp <= 0 || unit_per_zkp > Scheme::kMaxUnitPerZkp) {
+      return false;
+    }
+    if (unit_per_zkp < kMinUnitPerZkp && unit_per_zkp < n) return false;
+    return (n + unit_per_zkp - 1) / unit_per_zkp == proof_count;
+  }
+
+  // the witness (s * n) and the three r1cs products (m * n) of one unit,
+  // doubled for the hyrax and sec53 vectors derived from them
+  static int64_t UnitBytes() {
+    static int64_t const bytes = []() {
+      auto r1cs_info = VrsR1csInfo<Scheme>();
+      auto count = r1cs_info->num_variables + 3 * r1cs_info->num_constraints;
+      return 2 * count * (int64_t)sizeof(Fr);
+    }();
+    return bytes;
+  }
+
+  static int64_t DefaultMemoryBudget() {
+    if (debug::flags::vrs_memory_budget > 0) {
+      return debug::flags::vrs_memory_budget;
+    }
+#ifdef __linux__
+    auto pages = sysconf(_SC_PHYS_PAGES);
+    auto page_size = sysconf(_SC_PAGE_SIZE);
+    if (pages > 0 && page_size > 0) return (int64_t)pages * page_size / 2;
+#endif
+    return 4LL * 1024 * 1024 * 1024;
+  }
+};
+}  // namespace clink
@@ -7,19 +7,23 @@ namespace clink {
 
 template <typename Scheme>
 struct VrsPub {
+  enum { kBlockSize = 256 };
+
   struct Item {
     int64_t begin;
     int64_t end;
     int64_t n() const { return end - begin; }
   };
 
-  static std::vector<Item> SplitLargeTask(int64_t n) {
-    auto const kMaxUnitPerZkp = Scheme::kMaxUnitPerZkp;
-    std::vector<Item> items((n + kMaxUnitPerZkp - 1) / kMaxUnitPerZkp);
+  // the vrs caches are always split by Scheme::kMaxUnitPerZkp
+  static std::vector<Item> SplitLargeTask(
+      int64_t n, int64_t unit_per_zkp = Scheme::kMaxUnitPerZkp) {
+    assert(unit_per_zkp > 0);
+    std::vector<Item> items((n + unit_per_zkp - 1) / unit_per_zkp);
     for (int64_t i = 0; i < (int64_t)items.size(); ++i) {
       auto& item = items[i];
-      item.begin = i * kMaxUnitPerZkp;
-      item.end = item.begin + kMaxUnitPerZkp;
+      item.begin = i * unit_per_zkp;
+      item.end = item.begin + unit_per_zkp;
       if (item.end > n) {
         item.end = n;
       }
@@ -38,6 +42,64 @@ struct VrsPub {
     *out = H256ToFr(plain);
   }
 
+  // out[i] = GeneratePlain(plain_seed, begin + i), one hash object is reused
+  // for the whole range
+  static void GeneratePlain(Fr* out, h256_t const& plain_seed, int64_t begin,
+                            int64_t count) {
+    CryptoPP::Keccak_256 hash;
+    h256_t plain;
+    for (int64_t i = 0; i < count; ++i) {
+      hash.Update(plain_seed.data(), plain_seed.size());
+      auto offset_big = boost::endian::native_to_big(begin + i);
+      hash.Update((uint8_t const*)&offset_big, sizeof(offset_big));
+      hash.Final(plain.data());  // also restarts the hash
+      out[i] = H256ToFr(plain);
+    }
+  }
+
+  // GeneratePlain of [offset, offset + n) in parallel
+  static std::vector<Fr> GeneratePlainBatch(h256_t const& plain_seed,
+                                            int64_t n, int64_t offset = 0) {
+    std::vector<Fr> ret(n);
+    auto block_count = (n + kBlockSize - 1) / kBlockSize;
+    auto pf = [&ret, &plain_seed, n, offset](int64_t block) {
+      auto begin = block * kBlockSize;
+      auto count = std::min<int64_t>(kBlockSize, n - begin);
+      GeneratePlain(ret.data() + begin, plain_seed, offset + begin, count);
+    };
+    parallel::For(block_count, pf);
+    return ret;
+  }
+
+  // the witness of the units [begin, end) of plain_seed, vars[i][j] is the
+  // variable i of unit begin + j
+  static std::vector<std::vector<Fr>> GenerateWitness(
+      h256_t const& plain_seed, Fr const& key, int64_t begin, int64_t end) {
+    auto count = end - begin;
+    auto plain = GeneratePlainBatch(plain_seed, count, begin);
+    std::vector<std::vector<Fr>> vars(VrsNumVariables<Scheme>());
+    for (auto& i : vars) i.resize(count);
+    auto get_p = [&plain](int64_t j) -> Fr const& { return plain[j]; };
+    Scheme::GenerateWitness(get_p, key, count, vars);
+    return vars;
+  }
+
+  // Scheme::Generate of every plain, in blocks so that the scheme can
+  // batch the lanes and hoist the per-key work
+  static std::vector<Fr> GenerateV(std::vector<Fr> const& plain,
+                                   Fr const& key) {
+    int64_t n = (int64_t)plain.size();
+    std::vector<Fr> v(n);
+    auto block_count = (n + kBlockSize - 1) / kBlockSize;
+    auto pf = [&v, &plain, &key, n](int64_t block) {
+      auto begin = block * kBlockSize;
+      auto count = std::min<int64_t>(kBlockSize, n - begin);
+      Scheme::Generate(plain.data() + begin, v.data() + begin, count, key);
+    };
+    parallel::For(block_count, pf);
+    return v;
+  }
+
   static Fr GeneratePlain(h256_t const& plain_seed, int64_t position) {
     Fr ret;
     GeneratePlain(&ret, plain_seed, position);
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "../circuit_registry.h"
 #include "../details.h"
 #include "circuit/mimc5_gadget.h"
 #include "circuit/poseidon_gadget.h"
@@ -7,14 +8,119 @@
 
 namespace clink {
 
-struct VrsSha256cScheme {
-  VrsSha256cScheme() {
-    libsnark::protoboard<Fr> pb;
-    auto gadget = CreateGadget(pb);
-    r1cs_info.reset(new R1csInfo(pb));
+// the compiled r1cs of the scheme, shared by all the schemes of the process
+template <typename Scheme>
+std::shared_ptr<R1csInfo const> VrsR1csInfo() {
+  auto build = [](libsnark::protoboard<Fr>& pb) { Scheme::CreateGadget(pb); };
+  return CircuitRegistry::Instance().Get("vrs." + Scheme::type(), build,
+                                         &Scheme::CheckR1cs);
+}
+
+// the protoboard and gadget of the scheme owned by the current thread, the
+// gadget is assigned again for every unit instead of being rebuilt
+template <typename Scheme>
+struct VrsThreadGadget {
+  static VrsThreadGadget& Instance() {
+    static thread_local VrsThreadGadget instance;
+    return instance;
   }
 
-  std::unique_ptr<circuit::Sha256cGadget> CreateGadget(
+  libsnark::protoboard<Fr> pb;
+  decltype(Scheme::CreateGadget(pb)) gadget;
+
+ private:
+  VrsThreadGadget() : gadget(Scheme::CreateGadget(pb)) {}
+};
+
+// vars[i][j] = variable i of the gadget assigned with (get_p(j), key), the
+// units run in parallel on the gadget of each thread. used by the schemes
+// which have no native witness generator.
+template <typename Scheme, typename GetP>
+void VrsWitnessByGadget(GetP const& get_p, Fr const& key, int64_t n,
+                        std::vector<std::vector<Fr>>& vars) {
+  int64_t constexpr kBlockSize = 256;
+  auto block_count = (n + kBlockSize - 1) / kBlockSize;
+  auto pf = [&get_p, &key, &vars, n](int64_t block) {
+    auto& tg = VrsThreadGadget<Scheme>::Instance();
+    auto begin = block * kBlockSize;
+    auto end = std::min(begin + kBlockSize, n);
+    for (int64_t j = begin; j < end; ++j) {
+      tg.gadget->Assign(get_p(j), key);
+      assert(tg.pb.is_satisfied());
+      auto const& var = tg.pb.full_variable_assignment();
+      for (size_t i = 0; i < var.size(); ++i) vars[i][j] = var[i];
+    }
+  };
+  parallel::For(block_count, pf);
+}
+
+// vars[i][j] = variable i of Gadget::GenerateWitness(get_p(j), key)
+template <typename Gadget, typename GetP>
+void VrsWitnessNative(GetP const& get_p, Fr const& key, int64_t n,
+                      std::vector<std::vector<Fr>>& vars) {
+  auto pf = [&get_p, &key, &vars](int64_t j) {
+    auto out = [&vars, j](int64_t i) -> Fr& { return vars[i][j]; };
+    Gadget::GenerateWitness(get_p(j), key, out);
+  };
+  parallel::For(n, pf);
+}
+
+// true if w, the witness of one unit, satisfies the loaded circuit
+inline bool VrsCheckR1csWitness(R1csInfo const& r1cs_info, int64_t primary_size,
+                                std::vector<Fr> const& w) {
+  auto const& cs = r1cs_info.constraint_system;
+  if ((int64_t)cs.primary_input_size != primary_size) return false;
+  if ((int64_t)w.size() != r1cs_info.num_variables) return false;
+  std::vector<Fr> primary(w.begin(), w.begin() + primary_size);
+  std::vector<Fr> auxiliary(w.begin() + primary_size, w.end());
+  return cs.is_satisfied(primary, auxiliary);
+}
+
+// the native witness of one unit must have exactly the variables of the
+// circuit and satisfy it, so a circuit saved by another version of the
+// gadget is rejected without building the gadget
+template <typename Gadget>
+bool VrsCheckR1csNative(R1csInfo const& r1cs_info, int64_t primary_size) {
+  auto n = r1cs_info.num_variables;
+  std::vector<Fr> w(n + 1, FrZero());  // w[n] takes the overflow
+  int64_t max_index = -1;
+  auto out = [&w, &max_index, n](int64_t i) -> Fr& {
+    max_index = std::max(max_index, i);
+    return w[std::min(i, n)];
+  };
+  Gadget::GenerateWitness(FrRand(), FrRand(), out);
+  if (max_index + 1 != n) return false;
+  w.pop_back();
+  return VrsCheckR1csWitness(r1cs_info, primary_size, w);
+}
+
+// the same with the witness of the gadget of the current thread, for the
+// schemes without a native witness generator
+template <typename Scheme>
+bool VrsCheckR1csByGadget(R1csInfo const& r1cs_info, int64_t primary_size) {
+  auto n = r1cs_info.num_variables;
+  if ((int64_t)VrsThreadGadget<Scheme>::Instance().pb.num_variables() != n) {
+    return false;
+  }
+  std::vector<std::vector<Fr>> vars(n, std::vector<Fr>(1));
+  Fr plain = FrRand();
+  auto get_p = [&plain](int64_t) -> Fr const& { return plain; };
+  VrsWitnessByGadget<Scheme>(get_p, FrRand(), 1, vars);
+  std::vector<Fr> w(n);
+  for (int64_t i = 0; i < n; ++i) w[i] = vars[i][0];
+  return VrsCheckR1csWitness(r1cs_info, primary_size, w);
+}
+
+template <typename Scheme>
+int64_t VrsNumVariables() {
+  static int64_t const num_var = VrsR1csInfo<Scheme>()->num_variables;
+  return num_var;
+}
+
+struct VrsSha256cScheme {
+  VrsSha256cScheme() : r1cs_info(VrsR1csInfo<VrsSha256cScheme>()) {}
+
+  static std::unique_ptr<circuit::Sha256cGadget> CreateGadget(
       libsnark::protoboard<Fr>& pb) {
     std::unique_ptr<circuit::Sha256cGadget> ret;
     ret.reset(new circuit::Sha256cGadget(pb, "Sha256cGadget"));
@@ -26,6 +132,22 @@ struct VrsSha256cScheme {
     return circuit::Sha256Enc(plain, key);
   }
 
+  static void Generate(Fr const* plain, Fr* out, int64_t n, Fr const& key) {
+    circuit::Sha256EncBatch(plain, out, n, key);
+  }
+
+  // vars[i][j]: variable i of unit j in the layout of the gadget, vars must
+  // be VrsNumVariables<Scheme>() * n
+  template <typename GetP>
+  static void GenerateWitness(GetP const& get_p, Fr const& key, int64_t n,
+                              std::vector<std::vector<Fr>>& vars) {
+    VrsWitnessByGadget<VrsSha256cScheme>(get_p, key, n, vars);
+  }
+
+  static bool CheckR1cs(R1csInfo const& r1cs_info) {
+    return VrsCheckR1csByGadget<VrsSha256cScheme>(r1cs_info, kPrimaryInputSize);
+  }
+
   int64_t num_variables() const { return r1cs_info->num_variables; }
 
   int64_t num_constraints() const { return r1cs_info->num_constraints; }
@@ -42,17 +164,13 @@ struct VrsSha256cScheme {
     return a;
   };
 
-  std::unique_ptr<R1csInfo> r1cs_info;
+  std::shared_ptr<R1csInfo const> r1cs_info;
 };
 
 struct VrsMimc5Scheme {
-  VrsMimc5Scheme() {
-    libsnark::protoboard<Fr> pb;
-    auto gadget = CreateGadget(pb);
-    r1cs_info.reset(new R1csInfo(pb));
-  }
+  VrsMimc5Scheme() : r1cs_info(VrsR1csInfo<VrsMimc5Scheme>()) {}
 
-  std::unique_ptr<circuit::Mimc5Gadget> CreateGadget(
+  static std::unique_ptr<circuit::Mimc5Gadget> CreateGadget(
       libsnark::protoboard<Fr>& pb) {
     std::unique_ptr<circuit::Mimc5Gadget> ret;
     ret.reset(new circuit::Mimc5Gadget(pb, "Mimc5Gadget"));
@@ -64,6 +182,23 @@ struct VrsMimc5Scheme {
     return circuit::Mimc5Enc(plain, key);
   }
 
+  static void Generate(Fr const* plain, Fr* out, int64_t n, Fr const& key) {
+    circuit::Mimc5EncBatch(plain, out, n, key);
+  }
+
+  // vars[i][j]: variable i of unit j in the layout of the gadget, vars must
+  // be VrsNumVariables<Scheme>() * n
+  template <typename GetP>
+  static void GenerateWitness(GetP const& get_p, Fr const& key, int64_t n,
+                              std::vector<std::vector<Fr>>& vars) {
+    VrsWitnessNative<circuit::Mimc5Gadget>(get_p, key, n, vars);
+  }
+
+  static bool CheckR1cs(R1csInfo const& r1cs_info) {
+    return VrsCheckR1csNative<circuit::Mimc5Gadget>(r1cs_info,
+                                                    kPrimaryInputSize);
+  }
+
   int64_t num_variables() const { return r1cs_info->num_variables; }
 
   int64_t num_constraints() const { return r1cs_info->num_constraints; }
@@ -80,17 +215,13 @@ struct VrsMimc5Scheme {
     return a;
   };
 
-  std::unique_ptr<R1csInfo> r1cs_info;
+  std::shared_ptr<R1csInfo const> r1cs_info;
 };
 
 struct VrsPoseidonScheme {
-  VrsPoseidonScheme() {
-    libsnark::protoboard<Fr> pb;
-    auto gadget = CreateGadget(pb);
-    r1cs_info.reset(new R1csInfo(pb));
-  }
+  VrsPoseidonScheme() : r1cs_info(VrsR1csInfo<VrsPoseidonScheme>()) {}
 
-  std::unique_ptr<circuit::VrsPoseidon> CreateGadget(
+  static std::unique_ptr<circuit::VrsPoseidon> CreateGadget(
       libsnark::protoboard<Fr>& pb) {
     std::unique_ptr<circuit::VrsPoseidon> ret;
     ret.reset(new circuit::VrsPoseidon(pb, "PoseidonGadget"));
@@ -106,6 +237,27 @@ struct VrsPoseidonScheme {
     return ret[0];
   }
 
+  static void Generate(Fr const* plain, Fr* out, int64_t n, Fr const& key) {
+    std::array<Fr, 2> inputs{{FrZero(), key}};
+    for (int64_t i = 0; i < n; ++i) {
+      inputs[0] = plain[i];
+      out[i] = circuit::Poseidon<5, 1, 6, 52, 2, 1>(inputs)[0];
+    }
+  }
+
+  // vars[i][j]: variable i of unit j in the layout of the gadget, vars must
+  // be VrsNumVariables<Scheme>() * n
+  template <typename GetP>
+  static void GenerateWitness(GetP const& get_p, Fr const& key, int64_t n,
+                              std::vector<std::vector<Fr>>& vars) {
+    VrsWitnessNative<circuit::VrsPoseidon>(get_p, key, n, vars);
+  }
+
+  static bool CheckR1cs(R1csInfo const& r1cs_info) {
+    return VrsCheckR1csNative<circuit::VrsPoseidon>(r1cs_info,
+                                                    kPrimaryInputSize);
+  }
+
   int64_t num_variables() const { return r1cs_info->num_variables; }
 
   int64_t num_constraints() const { return r1cs_info->num_constraints; }
@@ -124,6 +276,6 @@ struct VrsPoseidonScheme {
     return a;
   };
 
-  std::unique_ptr<R1csInfo> r1cs_info;
+  std::shared_ptr<R1csInfo const> r1cs_info;
 };
 }  // namespace clink
\ No newline at end of file
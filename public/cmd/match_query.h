@@ -31,6 +31,41 @@ struct MatchQuery {
     }
   };
 
+  // the batched mode, all the rows in one r1cs proof and one pack proof
+  using BatchPack = clink::BatchQueryPack<Policy, circuit::MatchGadget>;
+
+  struct BatchProof {
+    typename Pod::ProvedData pod_proved_data;
+    typename BatchPack::Proof bp_proof;
+    bool operator==(BatchProof const& b) const {
+      return pod_proved_data == b.pod_proved_data && bp_proof == b.bp_proof;
+    }
+
+    bool operator!=(BatchProof const& b) const { return !(*this == b); }
+
+    template <typename Ar>
+    void serialize(Ar& ar) const {
+      ar& YAS_OBJECT_NVP("mq.bp", ("pod", pod_proved_data), ("bp", bp_proof));
+    }
+
+    template <typename Ar>
+    void serialize(Ar& ar) {
+      ar& YAS_OBJECT_NVP("mq.bp", ("pod", pod_proved_data), ("bp", bp_proof));
+    }
+  };
+
+  struct BatchProveOutput {
+    typename Pod::ProveOutput pod_output;
+    typename BatchPack::ProveOutput bp_output;
+
+    BatchProof BuildProof() const {
+      BatchProof ret;
+      ret.pod_proved_data = pod_output.proved_data;
+      ret.bp_proof = bp_output.proof;
+      return ret;
+    }
+  };
+
   struct ProveOutput {
     typename Pod::ProveOutput pod_output;
     std::vector<typename MatchPack::ProveOutput> mp_outputs;
@@ -128,6 +163,37 @@ struct MatchQuery {
     Pod::EncryptAndProve(output.pod_output, seed, data_y, input.data_dir);
   }
 
+  static void Prove(BatchProveOutput& output, h256_t seed,
+                    ProveInput const& input) {
+    Tick tick(__FN__);
+    int64_t n = input.n;
+    int64_t s = input.s;
+
+    UpdateSeed(seed, n, s, input.key);
+
+    auto const& data_x = input.data_x;
+    BatchPack::Prove(output.bp_output, seed, input.key, n, s, data_x.get_m,
+                     data_x.get_com, data_x.get_r, input.get_gx,
+                     input.get_gpy);
+
+    // pod y to bob
+    auto& bp_output = output.bp_output;
+    typename Pod::CommitedData data_y;
+    data_y.n = n;
+    data_y.s = (s + 252) / 253;
+    data_y.get_m = [&bp_output](int64_t i, int64_t j) -> Fr const& {
+      return bp_output.pack_y[i][j];
+    };
+    data_y.get_com = [&bp_output](int64_t i) -> G1 const& {
+      return bp_output.proof.com_pack_y[i];
+    };
+    data_y.get_r = [&bp_output](int64_t i) -> Fr const& {
+      return bp_output.com_pack_y_r[i];
+    };
+
+    Pod::EncryptAndProve(output.pod_output, seed, data_y, input.data_dir);
+  }
+
   struct VerifyInput {
     VerifyInput(Fr const& key, int64_t s, std::vector<G1> const& com_x,
                 GetRefG1 const& get_gx)
@@ -164,16 +230,14 @@ struct MatchQuery {
       }
     }
 
-    bool all_success = false;
-    auto parallel_f = [&proof, &seed, s, &input](int64_t i) {
+    // all the rows are checked by one multiexp
+    auto verify_f = [&proof, &seed, s, &input](int64_t i, MultiExpAcc& acc) {
       auto const& sp_proof = proof.mp_proofs[i];
       typename clink::MatchPack<Policy>::VerifyInput m_input(
           s, input.key, input.get_gx, input.get_gpy);
-      return clink::MatchPack<Policy>::Verify(sp_proof, seed, m_input);
+      return clink::MatchPack<Policy>::Verify(sp_proof, seed, m_input, acc);
     };
-    parallel::For(&all_success, n, parallel_f);
-
-    if (!all_success) {
+    if (!BatchVerifyDeferred(n, verify_f)) {
       assert(false);
       return false;
     }
@@ -191,6 +255,36 @@ struct MatchQuery {
     return true;
   }
 
+  static bool Verify(BatchProof const& proof, h256_t seed,
+                     VerifyInput const& input,
+                     typename Pod::VerifyOutput& output) {
+    Tick tick(__FN__);
+    int64_t n = input.n;
+    int64_t s = input.s;
+
+    UpdateSeed(seed, n, s, input.key);
+
+    auto get_com_x = [&input](int64_t i) -> G1 const& {
+      return input.com_x[i];
+    };
+    if (!BatchPack::Verify(proof.bp_proof, seed, input.key, n, s, get_com_x,
+                           input.get_gx, input.get_gpy)) {
+      assert(false);
+      return false;
+    }
+
+    auto get_com = [&proof](int64_t i) -> G1 const& {
+      return proof.bp_proof.com_pack_y[i];
+    };
+    auto pod_s = (s + 252) / 253;
+    if (!Pod::VerifyAndSign(output, seed, n, pod_s, get_com,
+                            proof.pod_proved_data)) {
+      assert(false);
+      return false;
+    }
+    return true;
+  }
+
   static bool DecryptData(int64_t n, int64_t s,
                           typename Pod::ProvedData const& proved_data,
                           typename Pod::Secret const& secret,
@@ -219,12 +313,19 @@ struct MatchQuery {
   }
 
   static bool Test(int64_t n, int64_t s, std::string const& key,
-                   std::string const& data_dir);
+                   std::string const& data_dir, bool batch = false);
+
+ private:
+  // prove with Output, then verify and decrypt
+  template <typename Output>
+  static bool TestRun(h256_t seed, ProveInput const& prove_input,
+                      VerifyInput const& verify_input,
+                      std::vector<boost::dynamic_bitset<uint8_t>>& rets);
 };
 
 template <typename Policy>
 bool MatchQuery<Policy>::Test(int64_t n, int64_t s, std::string const& key,
-                              std::string const& data_dir) {
+                              std::string const& data_dir, bool batch) {
   if (key.size() > 31) {
     std::cout << "invalid parameter: k.size() must <= 31.\n";
     return false;
@@ -280,10 +381,26 @@ bool MatchQuery<Policy>::Test(int64_t n, int64_t s, std::string const& key,
   data_x.get_m = [&x](int64_t i, int64_t j) -> Fr const& { return x[i][j]; };
 
   ProveInput prove_input(fr_key, data_x, get_gx, data_dir);
+  VerifyInput verify_input(fr_key, s, com_x, get_gx);
+  std::vector<boost::dynamic_bitset<uint8_t>> rets;
+  bool success =
+      batch ? TestRun<BatchProveOutput>(seed, prove_input, verify_input, rets)
+            : TestRun<ProveOutput>(seed, prove_input, verify_input, rets);
+  success = success && check_rets == rets;
+  auto const& cache = clink::Match<Policy>::CircuitCache::Instance();
+  std::cout << "circuit cache: " << cache.stats().to_string() << "\n";
+  std::cout << __FILE__ << " " << __FN__ << ": " << success << "\n\n\n\n\n\n";
+  return success;
+}
 
-  ProveOutput prove_output;
+template <typename Policy>
+template <typename Output>
+bool MatchQuery<Policy>::TestRun(
+    h256_t seed, ProveInput const& prove_input, VerifyInput const& verify_input,
+    std::vector<boost::dynamic_bitset<uint8_t>>& rets) {
+  Output prove_output;
   Prove(prove_output, seed, prove_input);
-  Proof proof = prove_output.BuildProof();
+  auto proof = prove_output.BuildProof();
 
 #ifndef DISABLE_SERIALIZE_CHECK
   // serialize to buffer
@@ -294,7 +411,7 @@ bool MatchQuery<Policy>::Test(int64_t n, int64_t s, std::string const& key,
   // serialize from buffer
   yas::mem_istream is(os.get_intrusive_buffer());
   yas::binary_iarchive<yas::mem_istream, YasBinF()> ia(is);
-  Proof proof2;
+  decltype(proof) proof2;
   ia.serialize(proof2);
   if (proof != proof2) {
     assert(false);
@@ -303,7 +420,6 @@ bool MatchQuery<Policy>::Test(int64_t n, int64_t s, std::string const& key,
   }
 #endif
 
-  VerifyInput verify_input(fr_key, s, com_x, get_gx);
   typename Pod::VerifyOutput verify_output;
   if (!Verify(proof, seed, verify_input, verify_output)) {
     assert(false);
@@ -318,15 +434,12 @@ bool MatchQuery<Policy>::Test(int64_t n, int64_t s, std::string const& key,
 
   prove_output.pod_output.cache->SetLeaked();
 
-  std::vector<boost::dynamic_bitset<uint8_t>> rets;
-  if (!DecryptData(n, s, proof.pod_proved_data, prove_output.pod_output.secret,
-                   verify_output, rets)) {
+  if (!DecryptData(prove_input.n, prove_input.s, proof.pod_proved_data,
+                   prove_output.pod_output.secret, verify_output, rets)) {
     assert(false);
     return false;
   }
 
-  bool success = check_rets == rets;
-  std::cout << __FILE__ << " " << __FN__ << ": " << success << "\n\n\n\n\n\n";
-  return success;
+  return true;
 }
 }  // namespace cmd
\ No newline at end of file
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstdint>
+
 namespace debug::flags {
 inline bool disable_vrs_cache = false;
-}
\ No newline at end of file
+inline bool huge_pages = false;
+inline int64_t vrs_memory_budget = 0;  // bytes, 0: half of the memory
+}
@@ -2,6 +2,7 @@
 
 #include "./funcs.h"
 #include "./multiexp.h"
+#include "./multiexp_acc.h"
 #include "./pc_base.h"
 #include "./serialize.h"
 #include "./types.h"
\ No newline at end of file
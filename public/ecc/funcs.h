@@ -133,6 +133,31 @@ inline void FrInv(Fr* begin, uint64_t count) {
 
 inline void FrInv(std::vector<Fr>& vec) { FrInv(vec.data(), vec.size()); }
 
+// s[k] = prod(bit j of k ? x[j] : y[j]), j < x.size(), k < n. round 0 is the
+// most significant bit. usually y[j] = 1/x[j], and swapping x and y gives
+// 1/s without any inversion. each round doubles the filled prefix, n muls in
+// total.
+inline void BuildChallengeTensor(std::vector<Fr> const& x,
+                                 std::vector<Fr> const& y, Fr* s, size_t n) {
+  auto rounds = x.size();
+  assert(y.size() == rounds);
+  assert(n <= (1ULL << rounds));
+  if (!n) return;
+
+  s[0] = FrOne();
+  size_t len = 1;  // filled prefix if n was not limited
+  for (size_t j = rounds; j-- > 0;) {
+    size_t have = std::min(len, n);
+    size_t high = len < n ? std::min(len, n - len) : 0;
+    auto parallel_f = [s, len, high, &x, &y, j](int64_t i) {
+      if ((size_t)i < high) s[len + i] = s[i] * x[j];
+      s[i] *= y[j];
+    };
+    parallel::For((int64_t)have, parallel_f, have < 16 * 1024);
+    len *= 2;
+  }
+}
+
 inline G1 G1Rand() {
   G1 out;
   bool b;
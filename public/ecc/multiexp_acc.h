@@ -0,0 +1,116 @@
+#pragma once
+
+#include <unordered_map>
+
+#include "./funcs.h"
+#include "./multiexp.h"
+
+// collects the terms of many verification equations into one multiexp, the
+// verifiers add w*(right - left) with a random w, all of them hold iff the
+// sum is zero (with overwhelming probability).
+// generators are taken by reference and merged by address, so the equations
+// which share them (get_g(i), PcH(), ...) add up their scalars instead of
+// adding more points; the generators must outlive the accumulator. the other
+// points (commitments, proof items) are copied.
+class MultiExpAcc {
+ public:
+  // generator, by reference
+  void Add(G1 const& base, Fr const& f) {
+    auto ret = index_.emplace(&base, bases_.size());
+    if (ret.second) {
+      bases_.push_back(&base);
+      scalars_.push_back(f);
+    } else {
+      scalars_[ret.first->second] += f;
+    }
+  }
+
+  // get_g(i) * f[i]
+  void Add(GetRefG1 const& get_g, Fr const* f, int64_t n) {
+    for (int64_t i = 0; i < n; ++i) Add(get_g(i), f[i]);
+  }
+
+  // other point, by value
+  void AddCopy(G1 const& point, Fr const& f) {
+    points_.push_back(point);
+    point_scalars_.push_back(f);
+  }
+
+  void Merge(MultiExpAcc&& other) {
+    for (size_t i = 0; i < other.bases_.size(); ++i) {
+      Add(*other.bases_[i], other.scalars_[i]);
+    }
+    points_.insert(points_.end(), other.points_.begin(), other.points_.end());
+    point_scalars_.insert(point_scalars_.end(), other.point_scalars_.begin(),
+                          other.point_scalars_.end());
+    other = MultiExpAcc();
+  }
+
+  size_t size() const { return bases_.size() + points_.size(); }
+
+  G1 Compute() const {
+    Tick tick(__FN__, std::to_string(size()));
+    auto m = bases_.size();
+    auto get_g = [this, m](int64_t i) -> G1 const& {
+      return (size_t)i < m ? *bases_[i] : points_[i - m];
+    };
+    auto get_f = [this, m](int64_t i) -> Fr const& {
+      return (size_t)i < m ? scalars_[i] : point_scalars_[i - m];
+    };
+    return MultiExpBdlo12<G1>(get_g, get_f, size());
+  }
+
+  bool Check() const { return Compute().isZero(); }
+
+ private:
+  std::unordered_map<G1 const*, size_t> index_;
+  std::vector<G1 const*> bases_;
+  std::vector<Fr> scalars_;
+  std::vector<G1> points_;
+  std::vector<Fr> point_scalars_;
+};
+
+// verify(i, acc) of every item runs in parallel and defers its multiexp checks
+// to its own accumulator, then all of them are checked by one multiexp.
+// verify returns false only if the proof is malformed.
+template <typename F>
+bool BatchVerifyDeferred(int64_t count, F const& verify) {
+  Tick tick(__FN__, std::to_string(count));
+  if (!count) return true;
+  std::vector<MultiExpAcc> accs(count);
+  bool all_success = false;
+  auto pf = [&accs, &verify](int64_t i) { return verify(i, accs[i]); };
+  parallel::For(&all_success, count, pf);
+  if (!all_success) return false;
+
+  MultiExpAcc acc;
+  for (auto& i : accs) acc.Merge(std::move(i));
+  return acc.Check();
+}
+
+// for the tests of BatchVerify: copies of a valid proof pass, then with
+// bad_proof at one index the batch fails and FindBad names that index.
+template <typename T>
+bool TestBatchVerify(typename T::Proof const& proof,
+                     typename T::Proof const& bad_proof, h256_t const& seed,
+                     typename T::VerifyInput const& input) {
+  using Item = typename T::BatchVerifyItem;
+  int64_t const count = 4;
+  int64_t const bad_index = 2;
+  int64_t bad;
+  std::vector<Item> items(count, Item(proof, seed, input));
+  if (!T::BatchVerify(items, &bad) || bad != -1) {
+    std::cout << __FN__ << " valid batch failed\n";
+    return false;
+  }
+
+  std::vector<Item> bad_items;
+  for (int64_t i = 0; i < count; ++i) {
+    bad_items.emplace_back(i == bad_index ? bad_proof : proof, seed, input);
+  }
+  if (T::BatchVerify(bad_items, &bad) || bad != bad_index) {
+    std::cout << __FN__ << " bad proof not found: " << bad << "\n";
+    return false;
+  }
+  return true;
+}
@@ -55,32 +55,32 @@ struct Sec43b {
     }
   };
 
+  // the producers (ParallelR1cs, BatchR1cs) write x, y, z into the matrices
+  // directly, the vector<vector> constructor copies and is only for the tests
   struct ProveInput {
-    std::vector<std::vector<Fr>> x;  // m*n
-    std::vector<std::vector<Fr>> y;
-    std::vector<std::vector<Fr>> z;
+    misc::Matrix<Fr> x;  // m*n
+    misc::Matrix<Fr> y;
+    misc::Matrix<Fr> z;
     GetRefG1 const& get_gx;
     GetRefG1 const& get_gy;
     GetRefG1 const& get_gz;
     size_t n_ = 0;
 
-    int64_t m() const { return x.size(); }
+    int64_t m() const { return x.m(); }
     int64_t n() const { return n_; }
     std::string to_string() const {
       return std::to_string(m()) + "*" + std::to_string(n());
     }
 
-    void Take(std::vector<std::vector<Fr>>& ox,
-              std::vector<std::vector<Fr>>& oy,
-              std::vector<std::vector<Fr>>& oz) {
+    void Take(misc::Matrix<Fr>& ox, misc::Matrix<Fr>& oy,
+              misc::Matrix<Fr>& oz) {
       ox = std::move(x);
       oy = std::move(y);
       oz = std::move(z);
     }
 
-    ProveInput(std::vector<std::vector<Fr>>&& x,
-               std::vector<std::vector<Fr>>&& y,
-               std::vector<std::vector<Fr>>&& z, GetRefG1 const& get_gx,
+    ProveInput(misc::Matrix<Fr>&& x, misc::Matrix<Fr>&& y,
+               misc::Matrix<Fr>&& z, GetRefG1 const& get_gx,
                GetRefG1 const& get_gy, GetRefG1 const& get_gz)
         : x(std::move(x)),
           y(std::move(y)),
@@ -91,10 +91,19 @@ struct Sec43b {
       Check();
     }
 
+    ProveInput(std::vector<std::vector<Fr>>&& x,
+               std::vector<std::vector<Fr>>&& y,
+               std::vector<std::vector<Fr>>&& z, GetRefG1 const& get_gx,
+               GetRefG1 const& get_gy, GetRefG1 const& get_gz)
+        : ProveInput(misc::Matrix<Fr>(std::move(x)),
+                     misc::Matrix<Fr>(std::move(y)),
+                     misc::Matrix<Fr>(std::move(z)), get_gx, get_gy,
+                     get_gz) {}
+
    private:
     void Check() {
       CHECK(!x.empty(), "");
-      CHECK(x.size() == y.size() && x.size() == z.size(), "");
+      CHECK(x.m() == y.m() && x.m() == z.m(), "");
       for (auto i = 0LL; i < m(); ++i) {
         CHECK(x[i].size() == y[i].size() && x[i].size() == z[i].size(), "");
         n_ = std::max(n_, x[i].size());
@@ -122,13 +131,19 @@ struct Sec43b {
     auto parallel_f = [&com_sec, &com_pub, &input](int64_t i) {
       std::array<parallel::VoidTask, 3> tasks;
       tasks[0] = [&com_pub, &input, &com_sec, i]() {
-        com_pub.a[i] = pc::ComputeCom(input.get_gx, input.x[i], com_sec.r[i]);
+        auto const& x = input.x[i];
+        com_pub.a[i] =
+            pc::ComputeCom(x.size(), input.get_gx, x.data(), com_sec.r[i]);
       };
       tasks[1] = [&com_pub, &input, &com_sec, i]() {
-        com_pub.b[i] = pc::ComputeCom(input.get_gy, input.y[i], com_sec.s[i]);
+        auto const& y = input.y[i];
+        com_pub.b[i] =
+            pc::ComputeCom(y.size(), input.get_gy, y.data(), com_sec.s[i]);
       };
       tasks[2] = [&com_pub, &input, &com_sec, i]() {
-        com_pub.c[i] = pc::ComputeCom(input.get_gz, input.z[i], com_sec.t[i]);
+        auto const& z = input.z[i];
+        com_pub.c[i] =
+            pc::ComputeCom(z.size(), input.get_gz, z.data(), com_sec.t[i]);
       };
       parallel::Invoke(tasks);
     };
@@ -170,18 +185,19 @@ struct Sec43b {
     G1 com_pub_53_c;
     Fr com_sec_53_t;
 
-    std::vector<std::vector<Fr>> input_x;
-    std::vector<std::vector<Fr>> input_y;
-    std::vector<std::vector<Fr>> input_z;
+    misc::Matrix<Fr> input_x;
+    misc::Matrix<Fr> input_y;
+    misc::Matrix<Fr> input_z;
     input.Take(input_x, input_y, input_z);
 
     struct Para53 {
-      Para53(int64_t m) : input_yt(m) {}
+      explicit Para53(misc::Matrix<Fr> const& y)
+          : input_yt(misc::Matrix<Fr>::SameShape(y)) {}
       typename Sec53::CommitmentSec com_sec_53;
       typename Sec53::CommitmentPub com_pub_53;
-      std::vector<std::vector<Fr>> input_yt;
+      misc::Matrix<Fr> input_yt;
       std::unique_ptr<typename Sec53::ProveInput> input_53;
-    } para53(m);
+    } para53(input_y);
 
     {
       Tick tick53(" sec43b->Sec53");
@@ -189,7 +205,9 @@ struct Sec43b {
       auto& com_sec_53 = para53.com_sec_53;
       auto& com_pub_53 = para53.com_pub_53;
 
-      auto parallel_f = [&input_x, &k](int64_t i) { input_x[i] *= k[i]; };
+      auto parallel_f = [&input_x, &k](int64_t i) {
+        for (auto& v : input_x[i]) v *= k[i];
+      };
       parallel::For(m, parallel_f);
 
       auto& input_yt = para53.input_yt;
@@ -201,8 +219,10 @@ struct Sec43b {
         // 2*m*n fr mul
         std::vector<Fr> ip(m);
         auto pf = [&input_x, &input_yt, &input_y, &t, &ip](int64_t i) {
-          input_yt[i] = HadamardProduct(input_y[i], t);
-          ip[i] = InnerProduct(input_x[i], input_yt[i]);
+          auto const& yi = input_y[i];
+          auto const& yti = input_yt[i];
+          for (size_t j = 0; j < yi.size(); ++j) yti[j] = yi[j] * t[j];
+          ip[i] = InnerProduct(input_x[i].data(), yti.data(), yti.size());
         };
         parallel::For(m, pf);
         z = std::accumulate(ip.begin(), ip.end(), FrZero());
@@ -323,18 +343,35 @@ struct Sec43b {
   static bool Verify(Proof const& proof, h256_t seed,
                      VerifyInput const& input) {
     Tick tick(__FN__, input.to_string());
+    MultiExpAcc acc;
+    if (!Verify(proof, seed, input, acc)) return false;
+    bool ret = acc.Check();
+    assert(ret);
+    return ret;
+  }
+
+  // folds the commitments here and defers the multiexp checks of Sec53 and
+  // HyraxA to acc, returns false only if the proof is malformed.
+  static bool Verify(Proof const& proof, h256_t seed, VerifyInput const& input,
+                     MultiExpAcc& acc) {
     auto m = input.m();
     auto n = input.n();
 
     auto const& com_pub = input.com_pub;
+    if (com_pub.a.size() != m || com_pub.b.size() != m ||
+        com_pub.c.size() != m) {
+      assert(false);
+      return false;
+    }
     UpdateSeed(seed, com_pub, m, n);
     std::vector<Fr> k(m);
     std::vector<Fr> t(n);
     ComputeChallengeKT(seed, k, t);
 
+    std::array<MultiExpAcc, 2> accs;
     std::array<parallel::VoidTask, 2> tasks;
     bool ret_53 = false;
-    tasks[0] = [&ret_53, &proof, &input, m, &com_pub, &k, &t, &seed]() {
+    tasks[0] = [&ret_53, &proof, &input, m, &com_pub, &k, &t, &seed, &accs]() {
       typename Sec53::CommitmentPub com_pub_53;
       com_pub_53.c = proof.c;
       com_pub_53.b = input.com_pub.b;
@@ -347,18 +384,17 @@ struct Sec43b {
       typename Sec53::VerifyInput input_53(input.mn, t, std::move(com_pub_53),
                                            input.get_gx, input.get_gy,
                                            SelectSec53Gz());
-      ret_53 = Sec53::Verify(proof.proof_53, seed, std::move(input_53));
-      assert(ret_53);
+      ret_53 =
+          Sec53::Verify(proof.proof_53, seed, std::move(input_53), accs[0]);
     };
 
     bool ret_a2 = false;
-    tasks[1] = [&ret_a2, &com_pub, &proof, &t, &k, &seed, &input]() {
+    tasks[1] = [&ret_a2, &com_pub, &proof, &t, &k, &seed, &input, &accs]() {
       typename HyraxA::CommitmentPub com_pub_hy(MultiExpBdlo12(com_pub.c, k),
                                                 proof.c);
       typename HyraxA::VerifyInput input_hy("43b", t, com_pub_hy, input.get_gz,
                                             SelectSec53Gz());
-      ret_a2 = HyraxA::Verify(proof.proof_a, seed, input_hy);
-      assert(ret_a2);
+      ret_a2 = HyraxA::Verify(proof.proof_a, seed, input_hy, accs[1]);
     };
 
     parallel::Invoke(tasks);
@@ -366,11 +402,52 @@ struct Sec43b {
     if (!ret_53 || !ret_a2) {
       std::cout << "ret_53: " << ret_53 << ", ret_a2: " << ret_a2 << "\n";
       assert(false);
+      return false;
     }
-    return ret_53 && ret_a2;
+    acc.Merge(std::move(accs[0]));
+    acc.Merge(std::move(accs[1]));
+    return true;
+  }
+
+  struct BatchVerifyItem {
+    BatchVerifyItem(Proof const& proof, h256_t const& seed,
+                    VerifyInput const& input)
+        : proof(proof), seed(seed), input(input) {}
+    Proof const& proof;
+    h256_t const seed;
+    VerifyInput const& input;
+  };
+
+  // the folding of every proof runs in parallel, then all the final checks are
+  // done by one multiexp. if failed and bad is not null, verify the proofs one
+  // by one and set *bad to the index of the first bad proof.
+  static bool BatchVerify(std::vector<BatchVerifyItem> const& items,
+                          int64_t* bad = nullptr) {
+    Tick tick(__FN__, std::to_string(items.size()));
+    if (bad) *bad = -1;
+    auto f = [&items](int64_t i, MultiExpAcc& acc) {
+      auto const& item = items[i];
+      return Verify(item.proof, item.seed, item.input, acc);
+    };
+    bool ret = BatchVerifyDeferred((int64_t)items.size(), f);
+    if (!ret && bad) *bad = FindBad(items);
+    return ret;
   }
 
   static bool Test(int64_t m, int64_t n);
+
+ private:
+  static int64_t FindBad(std::vector<BatchVerifyItem> const& items) {
+    std::vector<int64_t> rets(items.size());
+    auto pf = [&items, &rets](int64_t i) {
+      auto const& item = items[i];
+      MultiExpAcc acc;
+      rets[i] = Verify(item.proof, item.seed, item.input, acc) && acc.Check();
+    };
+    parallel::For((int64_t)items.size(), pf);
+    auto it = std::find(rets.begin(), rets.end(), 0);
+    return it == rets.end() ? -1 : (int64_t)(it - rets.begin());
+  }
 };
 
 template <typename Sec53, typename HyraxA>
@@ -453,6 +530,11 @@ bool Sec43b<Sec53, HyraxA>::Test(int64_t m, int64_t n) {
 
   VerifyInput verify_input(mn, com_pub, get_gx, get_gy, get_gz);
   bool success = Verify(proof, seed, verify_input);
+  if (success) {
+    Proof bad_proof = proof;
+    bad_proof.c += pc::PcH();
+    success = TestBatchVerify<Sec43b>(proof, bad_proof, seed, verify_input);
+  }
   std::cout << Tick::GetIndentString() << success << "\n\n\n\n\n\n";
   return success;
 }
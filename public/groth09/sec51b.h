@@ -326,6 +326,48 @@ struct Sec51b {
     return VerifyInternal(input, challenge, proof.com_ext_pub, proof.sub_proof);
   }
 
+  // defers the multiexp checks to acc, the three equations of VerifyInternal
+  // are weighted by random scalars w1, w2, w3:
+  //   w1*(com(gx,fx,rx) - a*e - ad) = 0
+  //   w2*(com(gy,fy,sy) - b*e - bd) = 0
+  //   w3*(com(gz,fz,tz) - c*e^2 - c1*e - c0) = 0
+  // if gx == gy the scalars of the shared generators are merged by acc.
+  // returns false only if the proof is malformed.
+  static bool Verify(Proof const& proof, h256_t seed, VerifyInput const& input,
+                     MultiExpAcc& acc) {
+    auto const& sub_proof = proof.sub_proof;
+    auto const n = sub_proof.fx.size();
+    if (n != sub_proof.fy.size() || n != input.t.size()) return false;
+
+    auto const& com_pub = input.com_pub;
+    auto const& com_ext_pub = proof.com_ext_pub;
+    UpdateSeed(seed, com_pub, com_ext_pub);
+    Fr e = H256ToFr(seed);
+
+    Fr w1 = FrRand();
+    Fr w2 = FrRand();
+    Fr w3 = FrRand();
+    std::vector<Fr> wfx = sub_proof.fx * w1;
+    acc.Add(input.get_gx, wfx.data(), n);
+    std::vector<Fr> wfy = sub_proof.fy * w2;
+    acc.Add(input.get_gy, wfy.data(), n);
+    acc.Add(pc::PcH(),
+            w1 * sub_proof.rx + w2 * sub_proof.sy + w3 * sub_proof.tz);
+    acc.AddCopy(com_pub.a, -w1 * e);
+    acc.AddCopy(com_ext_pub.ad, -w1);
+    acc.AddCopy(com_pub.b, -w2 * e);
+    acc.AddCopy(com_ext_pub.bd, -w2);
+
+    std::vector<Fr> proof_fyt(n);
+    HadamardProduct(proof_fyt, sub_proof.fy, input.t);
+    Fr fz = InnerProduct(sub_proof.fx, proof_fyt);
+    acc.AddCopy(input.gz, w3 * fz);
+    acc.AddCopy(com_pub.c, -w3 * e * e);
+    acc.AddCopy(com_ext_pub.c1, -w3 * e);
+    acc.AddCopy(com_ext_pub.c0, -w3);
+    return true;
+  }
+
   static bool Test(int64_t n);
 };
 
@@ -141,7 +141,7 @@ struct Sec51c {
   };
 
   static bool VerifyYt(Proof const& proof, h256_t seed,
-                       VerifyInput const& input) {
+                       VerifyInput const& input, MultiExpAcc* acc = nullptr) {
     std::vector<Fr> e(input.n());
     ComputeFst1(seed, "sec51c", e);
     auto et = HadamardProduct(e, input.t);
@@ -149,9 +149,22 @@ struct Sec51c {
     using eip = clink::EqualIp<hyrax::A3>;
     eip::VerifyInput input_eip(e, proof.com_yt, input.get_gyt, et,
                                input.com_pub.b, input.get_gy);
+    if (acc) return eip::Verify(seed, proof.proof_eip, input_eip, *acc);
     return eip::Verify(seed, proof.proof_eip, input_eip);
   }
 
+  static bool VerifyBp(Proof const& proof, h256_t const& seed,
+                       VerifyInput const& input) {
+    std::vector<G1> g1 = pc::CopyG(input.get_gx, input.n());
+    std::vector<G1> g2 = pc::CopyG(input.get_gyt, input.n());
+    bp::p31::CommitmentPub com_pub_bp;
+    com_pub_bp.p = input.com_pub.a + proof.com_yt;
+    com_pub_bp.q = input.com_pub.c;
+    bp::p31::VerifyInput input_p3(std::move(g1), std::move(g2), pc::PcH(),
+                                  input.gz, com_pub_bp);
+    return bp::p31::Verify(proof.proof_bp, seed, std::move(input_p3));
+  }
+
   static bool Verify(Proof const& proof, h256_t seed,
                      VerifyInput const& input) {
     UpdateSeed(seed, input.com_pub, input.t);
@@ -166,14 +179,7 @@ struct Sec51c {
     };
 
     tasks[1] = [&rets, &input, &proof, &seed]() {
-      std::vector<G1> g1 = pc::CopyG(input.get_gx, input.n());
-      std::vector<G1> g2 = pc::CopyG(input.get_gyt, input.n());
-      bp::p31::CommitmentPub com_pub_bp;
-      com_pub_bp.p = input.com_pub.a + proof.com_yt;
-      com_pub_bp.q = input.com_pub.c;
-      bp::p31::VerifyInput input_p3(std::move(g1), std::move(g2), pc::PcH(),
-                                    input.gz, com_pub_bp);
-      rets[1] = bp::p31::Verify(proof.proof_bp, seed, std::move(input_p3));
+      rets[1] = VerifyBp(proof, seed, input);
     };
 
     parallel::Invoke(tasks);
@@ -185,6 +191,30 @@ struct Sec51c {
     return true;
   }
 
+  // defers the multiexp checks of the equal_ip proof to acc, the bp proof
+  // folds its own generators so it is still checked here.
+  static bool Verify(Proof const& proof, h256_t seed, VerifyInput const& input,
+                     MultiExpAcc& acc) {
+    UpdateSeed(seed, input.com_pub, input.t);
+    UpdateSeed(seed, proof.com_yt);
+
+    std::array<std::atomic<bool>, 2> rets;
+    std::array<parallel::VoidTask, 2> tasks;
+    tasks[0] = [&rets, &proof, &seed, &input, &acc]() {
+      rets[0] = VerifyYt(proof, seed, input, &acc);
+    };
+    tasks[1] = [&rets, &input, &proof, &seed]() {
+      rets[1] = VerifyBp(proof, seed, input);
+    };
+    parallel::Invoke(tasks);
+
+    if (!rets[0] || !rets[1]) {
+      assert(false);
+      return false;
+    }
+    return true;
+  }
+
   static void ComputeCom(CommitmentPub& com_pub, CommitmentSec& com_sec,
                          ProveInput const& input) {
     // Tick tick(__FN__);
@@ -6,6 +6,7 @@
 #include "groth09/details.h"
 #include "groth09/sec51b.h"
 #include "groth09/sec51c.h"
+#include "misc/matrix.h"
 #include "utils/fst.h"
 
 // t: public vector<Fr>, size = n
@@ -72,24 +73,23 @@ struct Sec53b {
   };
 
   struct ProveInput {
-    std::vector<std::vector<Fr>> x;
-    std::vector<std::vector<Fr>> y;
+    misc::Matrix<Fr> x;
+    misc::Matrix<Fr> y;
     std::vector<Fr> const& t;
-    std::vector<std::vector<Fr>> yt;
+    misc::Matrix<Fr> yt;
     Fr z;
     GetRefG1 const& get_gx;
     GetRefG1 const& get_gy;
     G1 const& gz;
 
-    int64_t m() const { return x.size(); }
+    int64_t m() const { return x.m(); }
     int64_t n() const { return t.size(); }
     std::string to_string() const {
       return std::to_string(m()) + "*" + std::to_string(n());
     }
 
-    ProveInput(std::vector<std::vector<Fr>>&& x,
-               std::vector<std::vector<Fr>>&& y, std::vector<Fr> const& t,
-               std::vector<std::vector<Fr>>&& yt, Fr const& z,
+    ProveInput(misc::Matrix<Fr>&& x, misc::Matrix<Fr>&& y,
+               std::vector<Fr> const& t, misc::Matrix<Fr>&& yt, Fr const& z,
                GetRefG1 const& get_gx, GetRefG1 const& get_gy, G1 const& gz)
         : x(std::move(x)),
           y(std::move(y)),
@@ -102,8 +102,16 @@ struct Sec53b {
       Check();
     }
 
+    ProveInput(std::vector<std::vector<Fr>>&& x,
+               std::vector<std::vector<Fr>>&& y, std::vector<Fr> const& t,
+               std::vector<std::vector<Fr>>&& yt, Fr const& z,
+               GetRefG1 const& get_gx, GetRefG1 const& get_gy, G1 const& gz)
+        : ProveInput(misc::Matrix<Fr>(std::move(x)),
+                     misc::Matrix<Fr>(std::move(y)), t,
+                     misc::Matrix<Fr>(std::move(yt)), z, get_gx, get_gy, gz) {}
+
     void SortAndAlign(CommitmentPub& com_pub, CommitmentSec& com_sec) {
-      auto order = GetSortOrder(x);
+      auto order = GetSortOrder(x.row_sizes());
       PermuteAndAlign(order, com_pub);
       PermuteAndAlign(order, com_sec);
       PermuteAndAlign(order, x);
@@ -111,41 +119,117 @@ struct Sec53b {
       PermuteAndAlign(order, yt);
     }
 
+    // fold in place, the rows are sorted by size so row 2i is never shorter
+    // than row 2i+1. yt is linear in y so it folds the same way.
+    // if the folded matrix still has pairs, the cross terms of the next round
+    // are computed in the same pass while the folded block is in cache, see
+    // ComputeSigmaXY.
     void Update(Fr const& sigma_xy1, Fr const& sigma_xy2, Fr const& e,
                 Fr const& ee) {
       Tick tick(__FN__, to_string());
-      auto m2 = m() / 2;
-
-      {
-        std::vector<std::vector<Fr>> x2(m2);
-        std::vector<std::vector<Fr>> y2(m2);
-
-        auto pf1 = [this, &x2, &y2, &e](int64_t i) {
-          x2[i] = x[2 * i + 1] * e + x[2 * i];
-          y2[i] = y[2 * i] * e + y[2 * i + 1];
-        };
-        parallel::For(m2, pf1, n() < 1024);
-        x2.swap(x);
-        y2.swap(y);
+      z = sigma_xy1 * ee + z * e + sigma_xy2;
+      if (m() >= 4) {
+        FoldAndCross(e);
+      } else {
+        Fold(e);
       }
+    }
 
-      {
-        std::vector<std::vector<Fr>> yt2(m2);
-        auto parallel_f = [this, &yt2](int64_t i) {
-          yt2[i] = HadamardProduct(y[i], t);
-        };
-        parallel::For(m2, parallel_f, n() < 1024);
-        yt2.swap(yt);
-      }
+    // the cross terms of the current round, set by Update
+    bool has_next_sigma_xy = false;
+    Fr next_sigma_xy1;
+    Fr next_sigma_xy2;
 
-      z = sigma_xy1 * ee + z * e + sigma_xy2;
+   private:
+    enum { kBlockSize = 1024 };
+
+    void Fold(Fr const& e) {
+      using Row = misc::Matrix<Fr>::Row;
+      bool direct = n() < 1024;
+
+      // x2[i] = x[2i+1] * e + x[2i]
+      x.FoldPairs(
+          [&e](Row const& dst, Row const& src) {
+            for (size_t j = 0; j < src.size(); ++j) dst[j] += src[j] * e;
+          },
+          direct);
+
+      // y2[i] = y[2i] * e + y[2i+1]
+      auto fold_y = [&e](Row const& dst, Row const& src) {
+        for (size_t j = 0; j < src.size(); ++j) dst[j] = dst[j] * e + src[j];
+        for (size_t j = src.size(); j < dst.size(); ++j) dst[j] *= e;
+      };
+      y.FoldPairs(fold_y, direct);
+      yt.FoldPairs(fold_y, direct);
+      has_next_sigma_xy = false;
+    }
+
+    // one task per (4 rows, column block): folds the pairs (4k, 4k+1) and
+    // (4k+2, 4k+3) into rows 4k and 4k+2, which are the pair k of the next
+    // round, then adds <x[4k+2], yt[4k]> and <x[4k], yt[4k+2]> of the block.
+    void FoldAndCross(Fr const& e) {
+      auto m4 = m() / 4;
+      auto n = (int64_t)x[0].size();
+      int64_t block = std::max<int64_t>(std::min<int64_t>(n, kBlockSize), 1);
+      int64_t block_count = (n + block - 1) / block;
+      int64_t task_count = m4 * block_count;
+      std::vector<Fr> xy1(task_count, FrZero());
+      std::vector<Fr> xy2(task_count, FrZero());
+
+      auto fold = [this, &e](int64_t i, int64_t begin, int64_t end) {
+        auto const& x0 = x[i];
+        auto const& y0 = y[i];
+        auto const& yt0 = yt[i];
+        auto const& x1 = x[i + 1];
+        auto const& y1 = y[i + 1];
+        auto const& yt1 = yt[i + 1];
+        auto end0 = std::min<int64_t>(end, x0.size());
+        auto end1 = std::min<int64_t>(end0, x1.size());
+        int64_t j = begin;
+        for (; j < end1; ++j) {
+          x0[j] += x1[j] * e;
+          y0[j] = y0[j] * e + y1[j];
+          yt0[j] = yt0[j] * e + yt1[j];
+        }
+        for (; j < end0; ++j) {
+          y0[j] *= e;
+          yt0[j] *= e;
+        }
+      };
+
+      auto pf = [this, &fold, &xy1, &xy2, block, block_count, n](int64_t task) {
+        int64_t k = task / block_count;
+        int64_t begin = (task % block_count) * block;
+        int64_t end = std::min(begin + block, n);
+        fold(4 * k, begin, end);
+        fold(4 * k + 2, begin, end);
+
+        auto const& x0 = x[4 * k];
+        auto const& yt0 = yt[4 * k];
+        auto const& x1 = x[4 * k + 2];
+        auto const& yt1 = yt[4 * k + 2];
+        // row 4k is not shorter than row 4k+2
+        auto end1 = std::min<int64_t>(end, x1.size());
+        if (end1 <= begin) return;
+        xy1[task] = InnerProduct(x1.data() + begin, yt0.data() + begin,
+                                 end1 - begin);
+        xy2[task] = InnerProduct(x0.data() + begin, yt1.data() + begin,
+                                 end1 - begin);
+      };
+      parallel::For(task_count, pf, m4 * n < 16 * 1024);
+
+      x.KeepEvenRows();
+      y.KeepEvenRows();
+      yt.KeepEvenRows();
+      next_sigma_xy1 = parallel::Accumulate(xy1.begin(), xy1.end(), FrZero());
+      next_sigma_xy2 = parallel::Accumulate(xy2.begin(), xy2.end(), FrZero());
+      has_next_sigma_xy = true;
     }
 
-   private:
     void Check() {
       CHECK(!x.empty(), "");
 
-      CHECK(x.size() == y.size() && x.size() == yt.size(), "");
+      CHECK(x.m() == y.m() && x.m() == yt.m(), "");
 
       size_t max_n = 0;
       for (int64_t i = 0; i < m(); ++i) {
@@ -158,8 +242,8 @@ struct Sec53b {
 #ifdef _DEBUG
       Fr check_z = FrZero();
       for (int64_t i = 0; i < m(); ++i) {
-        CHECK(yt[i] == HadamardProduct(y[i], t), "");
-        check_z += InnerProduct(x[i], yt[i]);
+        CHECK(yt[i].to_vector() == HadamardProduct(y[i].to_vector(), t), "");
+        check_z += InnerProduct(x[i].data(), yt[i].data(), x[i].size());
       }
       CHECK(z == check_z, "");
 #endif
@@ -227,10 +311,14 @@ struct Sec53b {
     auto parallel_f = [&input, &com_pub, &com_sec](int64_t i) {
       std::array<parallel::VoidTask, 2> tasks{nullptr};
       tasks[0] = [&com_pub, &com_sec, &input, i]() {
-        com_pub->a[i] = pc::ComputeCom(input.get_gx, input.x[i], com_sec.r[i]);
+        auto const& x = input.x[i];
+        com_pub->a[i] = pc::ComputeCom(x.size(), input.get_gx, x.data(),
+                                       com_sec.r[i]);
       };
       tasks[1] = [&com_pub, &com_sec, &input, i]() {
-        com_pub->b[i] = pc::ComputeCom(input.get_gy, input.y[i], com_sec.s[i]);
+        auto const& y = input.y[i];
+        com_pub->b[i] = pc::ComputeCom(y.size(), input.get_gy, y.data(),
+                                       com_sec.s[i]);
       };
       parallel::Invoke(tasks);
     };
@@ -261,9 +349,11 @@ struct Sec53b {
     Tick tick(__FN__, input.to_string());
     DCHECK(input.m() == 1, "");
 
-    typename Sec51::ProveInput input_51(input.x[0], input.y[0], input.t,
-                                        input.yt[0], input.z, input.get_gx,
-                                        input.get_gy, input.gz);
+    auto x = input.x[0].to_vector();
+    auto y = input.y[0].to_vector();
+    auto yt = input.yt[0].to_vector();
+    typename Sec51::ProveInput input_51(x, y, input.t, yt, input.z,
+                                        input.get_gx, input.get_gy, input.gz);
 
     typename Sec51::CommitmentPub com_pub_51(com_pub.a[0], com_pub.b[0],
                                              com_pub.c);
@@ -283,11 +373,13 @@ struct Sec53b {
     auto parallel_f = [&input, &xy1, &xy2](int64_t i) {
       auto const& x1 = input.x[2 * i + 1];
       auto const& yt1 = input.yt[2 * i];
-      xy1[i] = InnerProduct(x1, yt1);
+      xy1[i] = InnerProduct(x1.data(), yt1.data(),
+                            std::min(x1.size(), yt1.size()));
 
       auto const& x2 = input.x[2 * i];
       auto const& yt2 = input.yt[2 * i + 1];
-      xy2[i] = InnerProduct(x2, yt2);
+      xy2[i] = InnerProduct(x2.data(), yt2.data(),
+                            std::min(x2.size(), yt2.size()));
     };
     parallel::For(m2, parallel_f, m * n < 16 * 1024);
 
@@ -333,7 +425,10 @@ struct Sec53b {
     com_sec = std::move(com_sec2);
   }
 
-  static Fr ComputeChallenge(h256_t const& seed, CommitmentPub const& com_pub,
+  // only the first round hashes the commitments, the folded ones of the later
+  // rounds are determined by them and the former challenges, which are bound
+  // by the seed. so the verifier can get all the challenges before folding.
+  static Fr ComputeChallenge(h256_t const& seed, CommitmentPub const* com_pub,
                              G1 const& cl, G1 const& cu) {
     // Tick tick(__FN__);
     CryptoPP::Keccak_256 hash;
@@ -341,9 +436,11 @@ struct Sec53b {
     HashUpdate(hash, seed);
     HashUpdate(hash, cl);
     HashUpdate(hash, cu);
-    HashUpdate(hash, com_pub.a);
-    HashUpdate(hash, com_pub.b);
-    HashUpdate(hash, com_pub.c);
+    if (com_pub) {
+      HashUpdate(hash, com_pub->a);
+      HashUpdate(hash, com_pub->b);
+      HashUpdate(hash, com_pub->c);
+    }
     hash.Final(digest.data());
     return H256ToFr(digest);
   }
@@ -354,7 +451,17 @@ struct Sec53b {
     assert(input.m() > 1);
 
     Fr sigma_xy1, sigma_xy2;
-    ComputeSigmaXY(input, &sigma_xy1, &sigma_xy2);
+    if (input.has_next_sigma_xy) {
+      sigma_xy1 = input.next_sigma_xy1;
+      sigma_xy2 = input.next_sigma_xy2;
+    } else {
+      ComputeSigmaXY(input, &sigma_xy1, &sigma_xy2);
+    }
+#ifdef _DEBUG
+    Fr check_xy1, check_xy2;
+    ComputeSigmaXY(input, &check_xy1, &check_xy2);
+    assert(check_xy1 == sigma_xy1 && check_xy2 == sigma_xy2);
+#endif
 
     // compute cl, cu
     Fr tl = FrRand();
@@ -365,7 +472,8 @@ struct Sec53b {
     proof.com_ext_pub.cu.push_back(cu);
 
     // challenge
-    Fr e = ComputeChallenge(seed, com_pub, cl, cu);
+    bool first_round = proof.com_ext_pub.cl.size() == 1;
+    Fr e = ComputeChallenge(seed, first_round ? &com_pub : nullptr, cl, cu);
     Fr ee = e * e;
     seed = FrToBin(e);
 
@@ -398,7 +506,36 @@ struct Sec53b {
 
   static bool Verify(Proof const& proof, h256_t seed, VerifyInput&& input) {
     Tick tick(__FN__, input.to_string());
+    if (!FoldCom(proof, seed, input)) return false;
+
+    auto const& com_pub = input.com_pub;
+    typename Sec51::CommitmentPub com_pub_51(com_pub.a[0], com_pub.b[0],
+                                             com_pub.c);
+    typename Sec51::VerifyInput verifier_input_51(
+        input.t, com_pub_51, input.get_gx, input.get_gy, input.gz);
+    return Sec51::Verify(proof.proof_51, seed, verifier_input_51);
+  }
 
+  // folds the commitments here and defers the multiexp checks of Sec51 to acc
+  static bool Verify(Proof const& proof, h256_t seed, VerifyInput&& input,
+                     MultiExpAcc& acc) {
+    if (!FoldCom(proof, seed, input)) return false;
+
+    auto const& com_pub = input.com_pub;
+    typename Sec51::CommitmentPub com_pub_51(com_pub.a[0], com_pub.b[0],
+                                             com_pub.c);
+    typename Sec51::VerifyInput verifier_input_51(
+        input.t, com_pub_51, input.get_gx, input.get_gy, input.gz);
+    return Sec51::Verify(proof.proof_51, seed, verifier_input_51, acc);
+  }
+
+ private:
+  // the verifier side of ProveRecursive, com_pub of input is folded to m = 1.
+  // the folded commitments are linear in the original ones and the
+  // coefficients are products of the challenges (like the bulletproofs
+  // verifier), so all the rounds are folded by one multiexp per vector
+  // instead of m scalar muls per round.
+  static bool FoldCom(Proof const& proof, h256_t& seed, VerifyInput& input) {
     input.SortAndAlign();
 
     if (!proof.CheckFormat(input.m())) {
@@ -407,46 +544,61 @@ struct Sec53b {
     }
 
     CommitmentPub& com_pub = input.com_pub;
+    auto const& cl = proof.com_ext_pub.cl;
+    auto const& cu = proof.com_ext_pub.cu;
+    auto round = cl.size();
+    std::vector<Fr> e(round);
+    for (size_t loop = 0; loop < round; ++loop) {
+      e[loop] = ComputeChallenge(seed, loop ? nullptr : &com_pub, cl[loop],
+                                 cu[loop]);
+      seed = FrToBin(e[loop]);
+    }
 
-    for (size_t loop = 0; loop < proof.com_ext_pub.cl.size(); ++loop) {
-      // challenge
-      auto const& cl = proof.com_ext_pub.cl[loop];
-      auto const& cu = proof.com_ext_pub.cu[loop];
-      Fr e = ComputeChallenge(seed, com_pub, cl, cu);
-      Fr ee = e * e;
-      seed = FrToBin(e);
-
-      std::vector<G1> a2(com_pub.m() / 2);
-      std::vector<G1> b2(com_pub.m() / 2);
-      G1 c2;
-
-      auto m2 = com_pub.m() / 2;
-      auto parallel_f = [&com_pub, &a2, &b2, &e](int64_t i) {
-        auto const& a = com_pub.a;
-        a2[i] = a[2 * i] + a[2 * i + 1] * e;
-
-        auto const& b = com_pub.b;
-        b2[i] = b[2 * i] * e + b[2 * i + 1];
-      };
-      parallel::For(m2, parallel_f, m2 < 1024);
-
-      c2 = cl * ee + com_pub.c * e + cu;
-
-      com_pub.a = std::move(a2);
-      com_pub.b = std::move(b2);
-      com_pub.c = std::move(c2);
+    // a2[i] = a[2i] + a[2i+1] * e, b2[i] = b[2i] * e + b[2i+1], round 0 is
+    // the lowest bit of the row index
+    auto m = input.m();
+    std::vector<Fr> e_rev(e.rbegin(), e.rend());
+    std::vector<Fr> ones(round, FrOne());
+    std::vector<Fr> coef_a(m);
+    std::vector<Fr> coef_b(m);
+    BuildChallengeTensor(e_rev, ones, coef_a.data(), m);
+    BuildChallengeTensor(ones, e_rev, coef_b.data(), m);
+
+    // c2 = cl * ee + c * e + cu
+    std::vector<G1> c_bases;
+    std::vector<Fr> coef_c;
+    c_bases.reserve(2 * round + 1);
+    coef_c.reserve(2 * round + 1);
+    Fr suffix = FrOne();  // product of the challenges after the round
+    for (size_t loop = round; loop-- > 0;) {
+      c_bases.push_back(cl[loop]);
+      coef_c.push_back(e[loop] * e[loop] * suffix);
+      c_bases.push_back(cu[loop]);
+      coef_c.push_back(suffix);
+      suffix *= e[loop];
     }
+    c_bases.push_back(com_pub.c);
+    coef_c.push_back(suffix);
 
-    assert(com_pub.m() == 1);
+    G1 a, b, c;
+    std::array<parallel::VoidTask, 3> tasks;
+    tasks[0] = [&a, &com_pub, &coef_a]() {
+      a = MultiExpBdlo12(com_pub.a, coef_a);
+    };
+    tasks[1] = [&b, &com_pub, &coef_b]() {
+      b = MultiExpBdlo12(com_pub.b, coef_b);
+    };
+    tasks[2] = [&c, &c_bases, &coef_c]() {
+      c = MultiExpBdlo12(c_bases, coef_c);
+    };
+    parallel::Invoke(tasks, m < 1024);
 
-    typename Sec51::CommitmentPub com_pub_51(com_pub.a[0], com_pub.b[0],
-                                             com_pub.c);
-    typename Sec51::VerifyInput verifier_input_51(
-        input.t, com_pub_51, input.get_gx, input.get_gy, input.gz);
-    return Sec51::Verify(proof.proof_51, seed, verifier_input_51);
+    com_pub.a.assign(1, a);
+    com_pub.b.assign(1, b);
+    com_pub.c = c;
+    return true;
   }
 
- private:
   static std::vector<size_t> GetSortOrder(std::vector<size_t> const& mn) {
     std::vector<size_t> order(mn.size());
     for (size_t i = 0; i < order.size(); ++i) {
@@ -459,15 +611,6 @@ struct Sec53b {
     return order;
   }
 
-  static std::vector<size_t> GetSortOrder(
-      std::vector<std::vector<Fr>> const& data) {
-    std::vector<size_t> mn(data.size());
-    for (size_t i = 0; i < mn.size(); ++i) {
-      mn[i] = data[i].size();
-    }
-    return GetSortOrder(mn);
-  }
-
   template <typename T>
   static void Permute(std::vector<size_t> const& order, std::vector<T>& v) {
     CHECK(order.size() == v.size(), "");
@@ -504,13 +647,9 @@ struct Sec53b {
   }
 
   static void PermuteAndAlign(std::vector<size_t> const& order,
-                              std::vector<std::vector<Fr>>& v) {
-    Permute(order, v);
-    int64_t old_m = v.size();
-    int64_t new_m = (int64_t)misc::Pow2UB(old_m);
-    if (new_m > old_m) {
-      v.resize(new_m);
-    }
+                              misc::Matrix<Fr>& v) {
+    v.Permute(order);
+    v.Align(misc::Pow2UB(v.m()));
   }
 
  public:
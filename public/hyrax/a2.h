@@ -230,7 +230,73 @@ struct A2 {
     return VerifyInternal(input, challenge, proof.com_ext_pub, proof.sub_proof);
   }
 
+  struct BatchVerifyItem {
+    BatchVerifyItem(Proof const& proof, h256_t const& seed,
+                    VerifyInput const& input)
+        : proof(proof), seed(seed), input(input) {}
+    Proof const& proof;
+    h256_t const seed;
+    VerifyInput const& input;
+  };
+
+  // defers the multiexp checks to acc, both equations are weighted by random
+  // scalars w1, w2:
+  //   w1*(gx*z + h*z_delta - xi*e - delta) = 0
+  //   w2*(gy*<z,a> + h*z_beta - tau*e - beta) = 0
+  // returns false only if the proof is malformed.
+  static bool Verify(Proof const& proof, h256_t seed, VerifyInput const& input,
+                     MultiExpAcc& acc) {
+    auto const& sub_proof = proof.sub_proof;
+    if (input.a.size() != sub_proof.z.size() || input.a.empty()) return false;
+
+    auto const& com_pub = input.com_pub;
+    auto const& com_ext_pub = proof.com_ext_pub;
+    UpdateSeed(seed, com_pub, com_ext_pub);
+    Fr e = H256ToFr(seed);
+
+    Fr w1 = FrRand();
+    Fr w2 = FrRand();
+    std::vector<Fr> g = sub_proof.z * w1;
+    acc.Add(input.get_gx, g.data(), input.n());
+    acc.Add(pc::PcH(), w1 * sub_proof.z_delta + w2 * sub_proof.z_beta);
+    acc.AddCopy(com_pub.xi, -w1 * e);
+    acc.AddCopy(com_ext_pub.delta, -w1);
+    acc.AddCopy(input.gy, w2 * InnerProduct(sub_proof.z, input.a));
+    acc.AddCopy(com_pub.tau, -w2 * e);
+    acc.AddCopy(com_ext_pub.beta, -w2);
+    return true;
+  }
+
+  // check all the proofs with one multiexp. if failed and bad is not null,
+  // verify the proofs one by one and set *bad to the index of the first bad
+  // proof.
+  static bool BatchVerify(std::vector<BatchVerifyItem> const& items,
+                          int64_t* bad = nullptr) {
+    Tick tick(__FN__, std::to_string(items.size()));
+    if (bad) *bad = -1;
+    auto f = [&items](int64_t i, MultiExpAcc& acc) {
+      auto const& item = items[i];
+      return Verify(item.proof, item.seed, item.input, acc);
+    };
+    bool ret = BatchVerifyDeferred((int64_t)items.size(), f);
+    if (!ret && bad) *bad = FindBad(items);
+    return ret;
+  }
+
   static bool Test(int64_t n);
+
+ private:
+  static int64_t FindBad(std::vector<BatchVerifyItem> const& items) {
+    std::vector<int64_t> rets(items.size());
+    auto pf = [&items, &rets](int64_t i) {
+      auto const& item = items[i];
+      MultiExpAcc acc;
+      rets[i] = Verify(item.proof, item.seed, item.input, acc) && acc.Check();
+    };
+    parallel::For((int64_t)items.size(), pf);
+    auto it = std::find(rets.begin(), rets.end(), 0);
+    return it == rets.end() ? -1 : (int64_t)(it - rets.begin());
+  }
 };
 
 // save to bin
@@ -327,6 +393,12 @@ bool A2::Test(int64_t n) {
 
   VerifyInput verify_input("test", a, com_pub, get_gx, pc::PcU());
   bool success = Verify(proof, UpdateSeed, verify_input);
+  if (success) {
+    Proof bad_proof = proof;
+    bad_proof.sub_proof.z_delta += FrOne();
+    success =
+        TestBatchVerify<A2>(proof, bad_proof, UpdateSeed, verify_input);
+  }
   std::cout << __FILE__ << " " << __FN__ << ": " << success << "\n\n\n\n\n\n";
   return success;
 }
@@ -136,32 +136,6 @@ struct A3 {
     hash.Final(seed.data());
   }
 
-  // NOTE: maybe can optimize?
-  static std::vector<G1> FuncO(std::vector<G1> const& g1, Fr const& k,
-                               std::vector<G1> const& g2, Fr const& l) {
-    assert(g1.size() == g2.size());
-    std::vector<G1> g(g1.size());
-
-    auto f = [&g, &g1, &g2, &k, &l](int64_t i) {
-      g[i] = g1[i] * k + g2[i] * l;
-    };
-    parallel::For(g.size(), f, g.size() < 10240);
-
-    return g;
-  }
-
-  template <typename T>
-  static void Divide(std::vector<T> const& t, std::vector<T>& t1,
-                     std::vector<T>& t2, T const& t0) {
-    auto n = t.size();
-    auto half = misc::Pow2UB(n) / 2;
-    t1.resize(half);
-    t2.resize(half);
-    std::copy(t.begin(), t.begin() + half, t1.begin());
-    std::copy(t.begin() + half, t.end(), t2.begin());
-    std::fill(t2.begin() + (n - half), t2.end(), t0);
-  }
-
   static void ComputeCom(CommitmentPub& com_pub, CommitmentSec const& com_sec,
                          ProveInput const& input) {
     Tick tick(__FN__);
@@ -175,20 +149,19 @@ struct A3 {
     parallel::Invoke(tasks, true);
   }
 
-  // TODO: change to move
-  static void Prove(Proof& proof, h256_t seed, ProveInput input,
-                    CommitmentPub com_pub, CommitmentSec com_sec) {
+  // every round folds t = (t1, t2) to half size, t1 = t[0, half) and
+  // t2 = t[half, len) padded with zero:
+  //   a = a1 * c_inv + a2 * c, g = g1 * c_inv + g2 * c, x = x1 * c + x2 * c_inv
+  // the first round reads x, a and the generators directly from the input and
+  // writes into buffers of half size, the later rounds fold in place.
+  static void Prove(Proof& proof, h256_t seed, ProveInput const& input,
+                    CommitmentPub const& com_pub,
+                    CommitmentSec const& com_sec) {
     Tick tick(__FN__, input.to_string());
     UpdateSeed(seed, input.a, com_pub);
 
-    auto x = input.x;
-    auto a = input.a;
-    auto y = input.y;
-    int64_t n = x.size();
+    int64_t n = input.n();
     int64_t round = (int64_t)misc::Log2UB(n);
-    auto gx = pc::CopyG(input.get_gx, n);
-    gx.resize(misc::Pow2UB(n), G1Zero());
-    // std::fill(gx.begin() + n, gx.end(), G1Zero());
     auto const& h = pc::PcH();
     proof.com_ext_pub.gamma_neg_1.resize(round);
     proof.com_ext_pub.gamma_pos_1.resize(round);
@@ -199,15 +172,27 @@ struct A3 {
     CommitmentExtPub& com_ext_pub = proof.com_ext_pub;
     auto const& gy = input.gy;
     G1 gamma = com_pub.xi + com_pub.tau;
+    Fr y = input.y;
+
+    int64_t buf_size = (int64_t)misc::Pow2UB(n) / 2;
+    std::vector<Fr> x(buf_size);
+    std::vector<Fr> a(buf_size);
+    std::vector<G1> g(buf_size);
+
+    Fr const* px = input.x.data();
+    Fr const* pa = input.a.data();
+    GetRefG1 get_g = input.get_gx;
+    int64_t len = n;
 
     // recursive round
     for (int64_t loop = 0; loop < round; ++loop) {
-      std::vector<Fr> x1, x2;
-      Divide(x, x1, x2, FrZero());
-      std::vector<Fr> a1, a2;
-      Divide(a, a1, a2, FrZero());
-      std::vector<G1> g1, g2;
-      Divide(gx, g1, g2, G1Zero());
+      int64_t half = (int64_t)misc::Pow2UB(len) / 2;
+      int64_t rest = len - half;  // the unpadded size of t2
+      Fr const* x2 = px + half;
+      Fr const* a2 = pa + half;
+      auto get_g2 = [&get_g, half](int64_t i) -> G1 const& {
+        return get_g(half + i);
+      };
 
       auto& gamma_neg_1 = com_ext_pub.gamma_neg_1[loop];
       auto& gamma_pos_1 = com_ext_pub.gamma_pos_1[loop];
@@ -218,20 +203,21 @@ struct A3 {
       Fr x1_a2;
       Fr x2_a1;
 
+      // the padding of t2 is zero, only rest items contribute
       std::array<parallel::VoidTask, 2> tasks;
-      tasks[0] = [&x1, &a2, &h, &r_gamma_neg_1, &gy, &g2, &gamma_neg_1,
-                  &x1_a2]() {
-        x1_a2 = InnerProduct(x1, a2);
+      tasks[0] = [px, a2, rest, &h, &r_gamma_neg_1, &gy, &get_g2,
+                  &gamma_neg_1, &x1_a2]() {
+        x1_a2 = InnerProduct(px, a2, rest);
         gamma_neg_1 = h * r_gamma_neg_1 + gy * x1_a2;
-        gamma_neg_1 += MultiExpBdlo12(g2, x1);
+        gamma_neg_1 += MultiExpBdlo12<G1>(get_g2, px, rest);
       };
-      tasks[1] = [&x2, &a1, &h, &r_gamma_pos_1, &gy, &g1, &gamma_pos_1,
+      tasks[1] = [x2, pa, rest, &h, &r_gamma_pos_1, &gy, &get_g, &gamma_pos_1,
                   &x2_a1]() {
-        x2_a1 = InnerProduct(x2, a1);
+        x2_a1 = InnerProduct(x2, pa, rest);
         gamma_pos_1 = h * r_gamma_pos_1 + gy * x2_a1;
-        gamma_pos_1 += MultiExpBdlo12(g1, x2);
+        gamma_pos_1 += MultiExpBdlo12<G1>(get_g, x2, rest);
       };
-      parallel::Invoke(tasks, g2.size() < 10240);
+      parallel::Invoke(tasks, half < 10240);
 
       UpdateSeed(seed, gamma_neg_1, gamma_pos_1);
       Fr c = H256ToFr(seed);
@@ -240,136 +226,183 @@ struct A3 {
       Fr cc_inv = FrInv(cc);
 
       gamma += gamma_neg_1 * cc + gamma_pos_1 * cc_inv;
-      a = a1 * c_inv + a2 * c;
-      gx = FuncO(g1, c_inv, g2, c);
-      x = x1 * c + x2 * c_inv;
       y += cc * x1_a2 + cc_inv * x2_a1;
       r_gamma += r_gamma_neg_1 * cc + r_gamma_pos_1 * cc_inv;
+
+      // item i only reads item i and i + half, so it is safe in place
+      auto pf = [&x, &a, &g, px, pa, &get_g, half, rest, &c,
+                 &c_inv](int64_t i) {
+        if (i < rest) {
+          a[i] = pa[i] * c_inv + pa[half + i] * c;
+          g[i] = get_g(i) * c_inv + get_g(half + i) * c;
+          x[i] = px[i] * c + px[half + i] * c_inv;
+        } else {
+          a[i] = pa[i] * c_inv;
+          g[i] = get_g(i) * c_inv;
+          x[i] = px[i] * c;
+        }
+      };
+      parallel::For(half, pf, half < 10240);
+
+      px = x.data();
+      pa = a.data();
+      get_g = [&g](int64_t i) -> G1 const& { return g[i]; };
+      len = half;
     }
 
-    assert(gx.size() == 1);
-    assert(x.size() == 1);
-    assert(a.size() == 1);
-    assert(y == x[0] * a[0]);
-    assert(gamma == gx[0] * x[0] + gy * y + h * r_gamma);
-    // std::cout << "gx[0]: " << gx[0] << "\n";
-    // std::cout << "a[0]: " << a[0] << "\n";
-    // std::cout << "gamma: " << gamma << "\n";
+    assert(len == 1);
+    G1 const& gx0 = get_g(0);
+    Fr const& x0 = px[0];
+    Fr const& a0 = pa[0];
+    assert(y == x0 * a0);
+    assert(gamma == gx0 * x0 + gy * y + h * r_gamma);
+    (void)x0;
 
     // final round
     com_ext_sec.d = FrRand();
     com_ext_sec.r_beta = FrRand();
     com_ext_sec.r_delta = FrRand();
-    com_ext_pub.delta = gx[0] * com_ext_sec.d + h * com_ext_sec.r_delta;
+    com_ext_pub.delta = gx0 * com_ext_sec.d + h * com_ext_sec.r_delta;
     com_ext_pub.beta = gy * com_ext_sec.d + h * com_ext_sec.r_beta;
     UpdateSeed(seed, com_ext_pub.delta, com_ext_pub.beta);
     Fr c = H256ToFr(seed);
     // std::cout << c << "\n";
     proof.sub_proof.z1 = com_ext_sec.d + c * y;
     proof.sub_proof.z2 =
-        a[0] * (c * r_gamma + com_ext_sec.r_beta) + com_ext_sec.r_delta;
+        a0 * (c * r_gamma + com_ext_sec.r_beta) + com_ext_sec.r_delta;
   }
 
+  // s[k] = prod(bit i of k ? c[i] : d[i]), d[i] = 1/c[i]
   static void BuildS(std::vector<Fr>& s, std::vector<Fr> const& c,
-                     std::vector<Fr> const& d, std::vector<Fr> const& cc) {
+                     std::vector<Fr> const& d) {
     Tick tick(__FN__);
     assert(c.size() == d.size());
-    auto round = c.size();
-    assert(s.size() <= (1ULL << round));
-
-    for (size_t k = 0; k < s.size(); ++k) {
-      if (k == 0) {
-        s[k] = FrOne();
-        for (size_t i = 0; i < round; ++i) {
-          s[k] *= d[i];
-        }
-      } else {
-        std::bitset<64> bits(k);
-        for (size_t i = 0; i < round; ++i) {
-          if (bits[round - i - 1]) {
-            bits[round - i - 1] = 0;
-            auto kk = bits.to_ulong();
-            s[k] = s[kk] * cc[i];
-            break;
-          }
-        }
-      }
-
-      //{
-      //  Fr check = FrOne();
-      //  std::bitset<64> bits(k);
-      //  for (size_t i = 0; i < round; ++i) {
-      //    if (bits[round - i - 1]) {
-      //      check *= c[i];
-      //    } else {
-      //      check *= d[i];
-      //    }
-      //  }
-      //  assert(s[k] == check);
-      //}
+    assert(s.size() <= (1ULL << c.size()));
+    BuildChallengeTensor(c, d, s.data(), s.size());
+  }
+
+  static bool CheckFormat(Proof const& proof, VerifyInput const& input) {
+    auto n = input.n();
+    auto const& com_ext_pub = proof.com_ext_pub;
+    return n && (int64_t)misc::Pow2UB(n) == proof.aligned_n() &&
+           com_ext_pub.gamma_pos_1.size() == com_ext_pub.gamma_neg_1.size();
+  }
+
+  // the challenges of the recursive rounds and of the final round
+  static void ComputeChallenges(Proof const& proof, h256_t seed,
+                                VerifyInput const& input,
+                                std::vector<Fr>& vec_c, Fr& c) {
+    CommitmentExtPub const& com_ext_pub = proof.com_ext_pub;
+    auto round = com_ext_pub.gamma_neg_1.size();
+    UpdateSeed(seed, input.a, input.com_pub);
+    vec_c.resize(round);
+    for (size_t loop = 0; loop < round; ++loop) {
+      auto const& gamma_neg_1 = com_ext_pub.gamma_neg_1[loop];
+      auto const& gamma_pos_1 = com_ext_pub.gamma_pos_1[loop];
+      UpdateSeed(seed, gamma_neg_1, gamma_pos_1);
+      vec_c[loop] = H256ToFr(seed);
     }
+    UpdateSeed(seed, com_ext_pub.delta, com_ext_pub.beta);
+    c = H256ToFr(seed);
   }
 
+  // the folded generator gx*s and all the other terms of the final equation
+  // go into one multiexp, see the overload with acc
   static bool Verify(Proof const& proof, h256_t seed,
                      VerifyInput const& input) {
     Tick tick(__FN__, input.to_string());
-    auto n = input.n();
-    if (!n || (int64_t)misc::Pow2UB(n) != proof.aligned_n()) {
+    MultiExpAcc acc;
+    if (!Verify(proof, seed, input, acc) || !acc.Check()) {
+      assert(false);
       return false;
     }
-    CommitmentPub const& com_pub = input.com_pub;
-    CommitmentExtPub const& com_ext_pub = proof.com_ext_pub;
-    int64_t round = (int64_t)misc::Log2UB(n);
+    return true;
+  }
 
-    UpdateSeed(seed, input.a, com_pub);
+  struct BatchVerifyItem {
+    BatchVerifyItem(Proof const& proof, h256_t const& seed,
+                    VerifyInput const& input)
+        : proof(proof), seed(seed), input(input) {}
+    Proof const& proof;
+    h256_t const seed;
+    VerifyInput const& input;
+  };
 
-    std::vector<Fr> vec_c(round);
-    std::vector<Fr> vec_d(round);
-    std::vector<Fr> vec_cc(round);
-    std::vector<Fr> vec_dd(round);
+  // defers the multiexp check to acc, the equation is weighted by a random
+  // scalar w:
+  //   w*((gx*s + gy*a)*z1 + h*z2 - (gamma*c + beta)*a - delta) = 0
+  // returns false only if the proof is malformed.
+  static bool Verify(Proof const& proof, h256_t seed, VerifyInput const& input,
+                     MultiExpAcc& acc) {
+    if (!CheckFormat(proof, input)) return false;
 
-    // recursive round
-    for (int64_t loop = 0; loop < round; ++loop) {
-      auto const& gamma_neg_1 = com_ext_pub.gamma_neg_1[loop];
-      auto const& gamma_pos_1 = com_ext_pub.gamma_pos_1[loop];
-      UpdateSeed(seed, gamma_neg_1, gamma_pos_1);
-      vec_c[loop] = H256ToFr(seed);
-      vec_cc[loop] = vec_c[loop] * vec_c[loop];
-    }
-    vec_d = vec_c;
-    FrInv(vec_d);
-    vec_dd = vec_cc;
-    FrInv(vec_dd);
+    auto const& com_pub = input.com_pub;
+    auto const& com_ext_pub = proof.com_ext_pub;
+    auto const& sub_proof = proof.sub_proof;
 
-    std::vector<Fr> s(n);
-    BuildS(s, vec_c, vec_d, vec_cc);
+    std::vector<Fr> vec_c;
+    Fr c;
+    ComputeChallenges(proof, seed, input, vec_c, c);
+    auto round = vec_c.size();
+    std::vector<Fr> vec_d = vec_c;
+    FrInv(vec_d);
 
-    G1 gx = MultiExpBdlo12<G1>(input.get_gx, s, s.size());
+    std::vector<Fr> s(input.n());
+    BuildS(s, vec_c, vec_d);
     Fr a = InnerProduct(input.a, s);
 
-    G1 gamma = com_pub.xi + com_pub.tau;
-    for (int64_t loop = 0; loop < round; ++loop) {
-      auto const& gamma_neg_1 = com_ext_pub.gamma_neg_1[loop];
-      auto const& gamma_pos_1 = com_ext_pub.gamma_pos_1[loop];
-      gamma += gamma_neg_1 * vec_cc[loop] + gamma_pos_1 * vec_dd[loop];
-    }
-
-    // final round
-    UpdateSeed(seed, com_ext_pub.delta, com_ext_pub.beta);
-    Fr c = H256ToFr(seed);
-    auto const& h = pc::PcH();
-    auto const& gy = input.gy;
-    auto const& sub_proof = proof.sub_proof;
-    G1 left = (gamma * c + com_ext_pub.beta) * a + com_ext_pub.delta;
-    G1 right = (gx + gy * a) * sub_proof.z1 + h * sub_proof.z2;
-    if (left != right) {
-      assert(false);
-      return false;
+    Fr w = FrRand();
+    Fr wz1 = w * sub_proof.z1;
+    for (auto& i : s) i *= wz1;
+    acc.Add(input.get_gx, s.data(), input.n());
+    acc.AddCopy(input.gy, wz1 * a);
+    acc.Add(pc::PcH(), w * sub_proof.z2);
+
+    Fr beta = -w * a;
+    Fr gamma = beta * c;
+    acc.AddCopy(com_pub.xi, gamma);
+    acc.AddCopy(com_pub.tau, gamma);
+    for (size_t loop = 0; loop < round; ++loop) {
+      Fr cc = vec_c[loop] * vec_c[loop];
+      Fr dd = vec_d[loop] * vec_d[loop];
+      acc.AddCopy(com_ext_pub.gamma_neg_1[loop], gamma * cc);
+      acc.AddCopy(com_ext_pub.gamma_pos_1[loop], gamma * dd);
     }
+    acc.AddCopy(com_ext_pub.beta, beta);
+    acc.AddCopy(com_ext_pub.delta, -w);
     return true;
   }
 
+  // check all the proofs with one multiexp. if failed and bad is not null,
+  // verify the proofs one by one and set *bad to the index of the first bad
+  // proof.
+  static bool BatchVerify(std::vector<BatchVerifyItem> const& items,
+                          int64_t* bad = nullptr) {
+    Tick tick(__FN__, std::to_string(items.size()));
+    if (bad) *bad = -1;
+    auto f = [&items](int64_t i, MultiExpAcc& acc) {
+      auto const& item = items[i];
+      return Verify(item.proof, item.seed, item.input, acc);
+    };
+    bool ret = BatchVerifyDeferred((int64_t)items.size(), f);
+    if (!ret && bad) *bad = FindBad(items);
+    return ret;
+  }
+
   static bool Test(int64_t n);
+
+ private:
+  static int64_t FindBad(std::vector<BatchVerifyItem> const& items) {
+    std::vector<int64_t> rets(items.size());
+    auto pf = [&items, &rets](int64_t i) {
+      auto const& item = items[i];
+      MultiExpAcc acc;
+      rets[i] = Verify(item.proof, item.seed, item.input, acc) && acc.Check();
+    };
+    parallel::For((int64_t)items.size(), pf);
+    auto it = std::find(rets.begin(), rets.end(), 0);
+    return it == rets.end() ? -1 : (int64_t)(it - rets.begin());
+  }
 };
 
 // save to bin
@@ -468,6 +501,11 @@ bool A3::Test(int64_t n) {
 
   VerifyInput verify_input("test", a, com_pub, get_gx, gy);
   bool success = Verify(proof, seed, verify_input);
+  if (success) {
+    Proof bad_proof = proof;
+    bad_proof.sub_proof.z2 += FrOne();
+    success = TestBatchVerify<A3>(proof, bad_proof, seed, verify_input);
+  }
   std::cout << __FILE__ << " " << __FN__ << ": " << success << "\n\n\n\n\n\n";
   return success;
 }
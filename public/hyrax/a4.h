@@ -287,7 +287,9 @@ struct A4 {
     com_sec = std::move(com_sec2);
   }
 
-  static Fr ComputeChallenge(h256_t const& seed, CommitmentPub const& com_pub,
+  // only the first round hashes the commitments, the folded ones are bound by
+  // the seed, see groth09::Sec53b::ComputeChallenge
+  static Fr ComputeChallenge(h256_t const& seed, CommitmentPub const* com_pub,
                              G1 const& cl, G1 const& cu) {
     // Tick tick(__FN__);
     CryptoPP::Keccak_256 hash;
@@ -295,8 +297,10 @@ struct A4 {
     HashUpdate(hash, seed);
     HashUpdate(hash, cl);
     HashUpdate(hash, cu);
-    HashUpdate(hash, com_pub.cx);
-    HashUpdate(hash, com_pub.cz);
+    if (com_pub) {
+      HashUpdate(hash, com_pub->cx);
+      HashUpdate(hash, com_pub->cz);
+    }
     hash.Final(digest.data());
     return H256ToFr(digest);
   }
@@ -318,7 +322,8 @@ struct A4 {
     proof.com_ext_pub.cu.push_back(cu);
 
     // challenge
-    Fr e = ComputeChallenge(seed, com_pub, cl, cu);
+    bool first_round = proof.com_ext_pub.cl.size() == 1;
+    Fr e = ComputeChallenge(seed, first_round ? &com_pub : nullptr, cl, cu);
     Fr ee = e * e;
     seed = FrToBin(e);
 
@@ -349,7 +354,19 @@ struct A4 {
 
   static bool Verify(Proof const& proof, h256_t seed, VerifyInput input) {
     Tick tick(__FN__, input.to_string());
+    MultiExpAcc acc;
+    if (!Verify(proof, seed, std::move(input), acc) || !acc.Check()) {
+      assert(false);
+      return false;
+    }
+    return true;
+  }
 
+  // all the challenges come from the transcript first, then cx and the
+  // cl/cu/cz chain are folded by one multiexp each (the coefficients are
+  // products of the challenges) and the A3 check is deferred to acc.
+  static bool Verify(Proof const& proof, h256_t seed, VerifyInput input,
+                     MultiExpAcc& acc) {
     input.SortAndAlign();
 
     if (!proof.CheckFormat(input.m())) {
@@ -358,40 +375,49 @@ struct A4 {
     }
 
     CommitmentPub& com_pub = input.com_pub;
+    auto const& cl = proof.com_ext_pub.cl;
+    auto const& cu = proof.com_ext_pub.cu;
+    auto round = cl.size();
+    std::vector<Fr> e(round);
+    for (size_t loop = 0; loop < round; ++loop) {
+      e[loop] = ComputeChallenge(seed, loop ? nullptr : &com_pub, cl[loop],
+                                 cu[loop]);
+      seed = FrToBin(e[loop]);
+      input.Update(e[loop]);
+    }
+
+    // cx2[i] = cx[2i] + cx[2i+1] * e, round 0 is the lowest bit of i
+    auto m = com_pub.m();
+    std::vector<Fr> e_rev(e.rbegin(), e.rend());
+    std::vector<Fr> ones(round, FrOne());
+    std::vector<Fr> coef_x(m);
+    BuildChallengeTensor(e_rev, ones, coef_x.data(), m);
+
+    // cz2 = cl * ee + cz * e + cu
+    std::vector<G1> z_bases;
+    std::vector<Fr> coef_z;
+    z_bases.reserve(2 * round + 1);
+    coef_z.reserve(2 * round + 1);
+    Fr suffix = FrOne();  // product of the challenges after the round
+    for (size_t loop = round; loop-- > 0;) {
+      z_bases.push_back(cl[loop]);
+      coef_z.push_back(e[loop] * e[loop] * suffix);
+      z_bases.push_back(cu[loop]);
+      coef_z.push_back(suffix);
+      suffix *= e[loop];
+    }
+    z_bases.push_back(com_pub.cz);
+    coef_z.push_back(suffix);
+
+    G1 cx = MultiExpBdlo12(com_pub.cx, coef_x);
+    G1 cz = MultiExpBdlo12(z_bases, coef_z);
 
-    for (size_t loop = 0; loop < proof.com_ext_pub.cl.size(); ++loop) {
-      // challenge
-      auto const& cl = proof.com_ext_pub.cl[loop];
-      auto const& cu = proof.com_ext_pub.cu[loop];
-      Fr e = ComputeChallenge(seed, com_pub, cl, cu);
-      Fr ee = e * e;
-      seed = FrToBin(e);
-
-      input.Update(e);
-
-      std::vector<G1> cx2(com_pub.m() / 2);
-      G1 cz2;
-
-      auto m2 = com_pub.m() / 2;
-      auto parallel_f = [&com_pub, &cx2, &e](int64_t i) {
-        auto const& cx = com_pub.cx;
-        cx2[i] = cx[2 * i] + cx[2 * i + 1] * e;
-      };
-      parallel::For(m2, parallel_f, m2 < 1024);
-
-      cz2 = cl * ee + com_pub.cz * e + cu;
-
-      com_pub.cx = std::move(cx2);
-      com_pub.cz = std::move(cz2);
-    }
-
-    assert(com_pub.m() == 1);
     assert(input.a.size() == 1);
 
-    A3::CommitmentPub com_pub_a3(com_pub.cx[0], com_pub.cz);
+    A3::CommitmentPub com_pub_a3(cx, cz);
     A3::VerifyInput verifier_input_a3(input.tag, input.a[0], com_pub_a3,
                                       input.get_gx, input.gz);
-    return A3::Verify(proof.proof_a3, seed, verifier_input_a3);
+    return A3::Verify(proof.proof_a3, seed, verifier_input_a3, acc);
   }
 
  private:
@@ -0,0 +1,142 @@
+#include <stdlib.h>
+
+#include <functional>
+#include <mutex>
+#include <new>
+#include <unordered_set>
+
+#ifdef _WIN32
+#include <malloc.h>
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+
+#include "./mem.h"
+
+// replace the global operator new/delete so that mem::counters sees every
+// container allocation. the memory still comes from malloc, which is routed to
+// tbbmalloc by tbbmalloc_proxy. the aligned overloads are not replaced and are
+// not counted. MEM_PROFILE is set after main starts, so the blocks allocated
+// before are not counted; the tracked blocks are kept in a set (its nodes come
+// from malloc directly) and only those are subtracted when freed.
+
+namespace {
+template <typename T>
+struct MallocAllocator {
+  typedef T value_type;
+  MallocAllocator() = default;
+  template <typename U>
+  MallocAllocator(MallocAllocator<U> const&) {}
+  T* allocate(size_t n) {
+    void* p = malloc(n * sizeof(T));
+    if (!p) throw std::bad_alloc();
+    return (T*)p;
+  }
+  void deallocate(T* p, size_t) { free(p); }
+  template <typename U>
+  bool operator==(MallocAllocator<U> const&) const {
+    return true;
+  }
+  template <typename U>
+  bool operator!=(MallocAllocator<U> const&) const {
+    return false;
+  }
+};
+
+class TrackedBlocks {
+ public:
+  void Insert(void* p) {
+    auto& shard = shards_[Index(p)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.blocks.insert(p);
+  }
+
+  // false if p was allocated before MEM_PROFILE was set
+  bool Erase(void* p) {
+    auto& shard = shards_[Index(p)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.blocks.erase(p) != 0;
+  }
+
+ private:
+  enum { kShardCount = 64 };
+
+  static size_t Index(void* p) {
+    return ((uintptr_t)p >> 4) * 0x9E3779B97F4A7C15ULL >> 58;
+  }
+
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_set<void*, std::hash<void*>, std::equal_to<void*>,
+                       MallocAllocator<void*>>
+        blocks;
+  };
+  Shard shards_[kShardCount];
+};
+
+// never destroyed, the blocks may be freed during the static destruction
+inline TrackedBlocks& Tracked() {
+  static TrackedBlocks* tracked = new (malloc(sizeof(TrackedBlocks)))
+      TrackedBlocks;
+  return *tracked;
+}
+
+inline size_t UsableSize(void* p) {
+#ifdef _WIN32
+  return _msize(p);
+#elif defined(__APPLE__)
+  return malloc_size(p);
+#else
+  return malloc_usable_size(p);
+#endif
+}
+
+inline void* Alloc(size_t size) {
+  void* p = malloc(size ? size : 1);
+  if (p && MEM_PROFILE) {
+    Tracked().Insert(p);
+    mem::OnAlloc(UsableSize(p));
+  }
+  return p;
+}
+
+inline void Free(void* p) {
+  if (!p) return;
+  if (MEM_PROFILE && Tracked().Erase(p)) mem::OnFree(UsableSize(p));
+  free(p);
+}
+}  // namespace
+
+void* operator new(size_t size) {
+  void* p = Alloc(size);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+void* operator new[](size_t size) {
+  void* p = Alloc(size);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+void* operator new(size_t size, std::nothrow_t const&) noexcept {
+  return Alloc(size);
+}
+
+void* operator new[](size_t size, std::nothrow_t const&) noexcept {
+  return Alloc(size);
+}
+
+void operator delete(void* p) noexcept { Free(p); }
+
+void operator delete[](void* p) noexcept { Free(p); }
+
+void operator delete(void* p, size_t) noexcept { Free(p); }
+
+void operator delete[](void* p, size_t) noexcept { Free(p); }
+
+void operator delete(void* p, std::nothrow_t const&) noexcept { Free(p); }
+
+void operator delete[](void* p, std::nothrow_t const&) noexcept { Free(p); }
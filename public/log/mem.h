@@ -0,0 +1,174 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+extern bool MEM_PROFILE;
+
+// allocation tracking, fed by the operator new/delete replacement in mem.cc.
+// nothing is counted unless MEM_PROFILE is set (pod_dummy --mem_profile).
+// all numbers are process wide: a span reports the high-water mark of the
+// whole process while the span is open, not only its own allocations.
+namespace mem {
+
+enum { kMaxSpans = 64 };
+
+struct Counters {
+  std::atomic<int64_t> live{0};
+  std::atomic<int64_t> peak{0};
+  std::atomic<int64_t> alloc_count{0};
+  std::atomic<int64_t> alloc_bytes{0};
+  // bit i set: span_peak[i] belongs to an open span
+  std::atomic<uint64_t> span_mask{0};
+  std::array<std::atomic<int64_t>, kMaxSpans> span_peak{};
+};
+
+inline Counters counters;
+
+inline void UpdateMax(std::atomic<int64_t>& a, int64_t v) {
+  auto old = a.load(std::memory_order_relaxed);
+  while (old < v &&
+         !a.compare_exchange_weak(old, v, std::memory_order_relaxed)) {
+  }
+}
+
+inline void OnAlloc(size_t size) {
+  auto n = (int64_t)size;
+  auto live = counters.live.fetch_add(n, std::memory_order_relaxed) + n;
+  counters.alloc_count.fetch_add(1, std::memory_order_relaxed);
+  counters.alloc_bytes.fetch_add(n, std::memory_order_relaxed);
+  UpdateMax(counters.peak, live);
+
+  auto mask = counters.span_mask.load(std::memory_order_relaxed);
+  for (int i = 0; mask; ++i, mask >>= 1) {
+    if (mask & 1) UpdateMax(counters.span_peak[i], live);
+  }
+}
+
+inline void OnFree(size_t size) {
+  counters.live.fetch_sub((int64_t)size, std::memory_order_relaxed);
+}
+
+inline int64_t Live() { return counters.live.load(std::memory_order_relaxed); }
+
+inline int64_t Peak() { return counters.peak.load(std::memory_order_relaxed); }
+
+inline double ToMB(int64_t bytes) { return (double)bytes / (1024 * 1024); }
+
+// return -1 if all slots are busy, the span then falls back to the global peak
+inline int AcquireSlot(int64_t live) {
+  auto mask = counters.span_mask.load();
+  for (;;) {
+    if (mask == ~0ULL) return -1;
+    int i = 0;
+    while (mask & (1ULL << i)) ++i;
+    if (counters.span_mask.compare_exchange_weak(mask, mask | (1ULL << i))) {
+      counters.span_peak[i].store(live);
+      return i;
+    }
+  }
+}
+
+inline void ReleaseSlot(int i) {
+  if (i >= 0) counters.span_mask.fetch_and(~(1ULL << i));
+}
+
+struct PhaseStat {
+  int64_t count = 0;        // how many spans
+  int64_t peak = 0;         // max live bytes while any span was open
+  int64_t growth = 0;       // max (peak - live at span start)
+  int64_t alloc_count = 0;  // allocations while the spans were open
+  int64_t alloc_bytes = 0;
+};
+
+inline std::mutex phase_mutex;
+inline std::map<std::string, PhaseStat> phases;
+
+inline void Record(std::string const& name, int64_t peak, int64_t growth,
+                   int64_t alloc_count, int64_t alloc_bytes) {
+  std::lock_guard<std::mutex> lock(phase_mutex);
+  auto& stat = phases[name];
+  ++stat.count;
+  stat.peak = std::max(stat.peak, peak);
+  stat.growth = std::max(stat.growth, growth);
+  stat.alloc_count += alloc_count;
+  stat.alloc_bytes += alloc_bytes;
+}
+
+// one per Tick
+class Span {
+ public:
+  Span() {
+    if (!MEM_PROFILE) return;
+    enabled_ = true;
+    start_live_ = Live();
+    start_count_ = counters.alloc_count.load(std::memory_order_relaxed);
+    start_bytes_ = counters.alloc_bytes.load(std::memory_order_relaxed);
+    slot_ = AcquireSlot(start_live_);
+  }
+
+  ~Span() { ReleaseSlot(slot_); }
+
+  // return the high-water mark, -1 if not enabled
+  int64_t End(std::string const& name) {
+    if (!enabled_) return -1;
+    enabled_ = false;
+    int64_t peak = slot_ >= 0 ? counters.span_peak[slot_].load() : Peak();
+    ReleaseSlot(slot_);
+    slot_ = -1;
+    peak = std::max(peak, start_live_);
+    auto count =
+        counters.alloc_count.load(std::memory_order_relaxed) - start_count_;
+    auto bytes =
+        counters.alloc_bytes.load(std::memory_order_relaxed) - start_bytes_;
+    Record(name, peak, peak - start_live_, count, bytes);
+    return peak;
+  }
+
+ private:
+  bool enabled_ = false;
+  int slot_ = -1;
+  int64_t start_live_ = 0;
+  int64_t start_count_ = 0;
+  int64_t start_bytes_ = 0;
+};
+
+inline void Dump(std::ostream& os) {
+  std::vector<std::pair<std::string, PhaseStat>> items;
+  {
+    std::lock_guard<std::mutex> lock(phase_mutex);
+    items.assign(phases.begin(), phases.end());
+  }
+  std::sort(items.begin(), items.end(), [](auto const& a, auto const& b) {
+    return a.second.peak > b.second.peak;
+  });
+
+  auto flags = os.flags();
+  os << std::fixed << std::setprecision(1);
+  os << "memory profile, peak: " << ToMB(Peak())
+     << " MB, live: " << ToMB(Live())
+     << " MB, allocations: " << counters.alloc_count.load() << "\n";
+  os << std::setw(12) << "peak(MB)" << std::setw(12) << "growth(MB)"
+     << std::setw(14) << "allocs" << std::setw(14) << "alloc(MB)"
+     << std::setw(8) << "count"
+     << "  phase\n";
+  for (auto const& i : items) {
+    auto const& stat = i.second;
+    os << std::setw(12) << ToMB(stat.peak) << std::setw(12)
+       << ToMB(stat.growth) << std::setw(14) << stat.alloc_count
+       << std::setw(14) << ToMB(stat.alloc_bytes) << std::setw(8)
+       << stat.count << "  " << i.first << "\n";
+  }
+  os.flags(flags);
+}
+
+}  // namespace mem
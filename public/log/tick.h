@@ -6,9 +6,12 @@
 #include <iostream>
 #include <string>
 
+#include "./mem.h"
+
 struct Tick {
   Tick(std::string const& desc) : desc_(desc) {
     Uniform();
+    name_ = desc_;
     start_ = std::chrono::steady_clock::now();
     std::cout << GetIndentString(GetIndent());
     std::cout << "==> " << desc_ << "\n";
@@ -16,6 +19,7 @@ struct Tick {
   }
   Tick(std::string const& desc, std::string const& desc2) : desc_(desc) {
     Uniform();
+    name_ = desc_;
     desc_ += " ";
     desc_ += desc2;
     start_ = std::chrono::steady_clock::now();
@@ -27,13 +31,18 @@ struct Tick {
     auto t = std::chrono::steady_clock::now() - start_;
     auto s = std::chrono::duration_cast<std::chrono::seconds>(t);
     auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(t);
+    auto peak = mem_span_.End(name_);
     DecIndent();
     std::cout << GetIndentString(GetIndent());
     if (s.count() < 100) {
-      std::cout << "<== " << desc_ << " tick: " << ms.count() << " ms\n";
+      std::cout << "<== " << desc_ << " tick: " << ms.count() << " ms";
     } else {
-      std::cout << "<== " << desc_ << " tick: " << s.count() << " seconds\n";
+      std::cout << "<== " << desc_ << " tick: " << s.count() << " seconds";
+    }
+    if (peak >= 0) {
+      std::cout << ", peak: " << (int64_t)mem::ToMB(peak) << " MB";
     }
+    std::cout << "\n";
   }
 
   static void IncIndent() { IndentInner(1, false); }
@@ -73,7 +82,9 @@ struct Tick {
   }
 
   std::string desc_;
+  std::string name_;  // desc_ without desc2, the key of the memory phase
   std::chrono::steady_clock::time_point start_;
+  mem::Span mem_span_;
 };
 
 #ifdef __GNUC__
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "debug/flags.h"
+#include "log/mem.h"
+#include "misc/debug.h"
+#include "public.h"
+
+// bump allocator for the big matrices of the provers, see misc/matrix.h.
+// arenas are recycled by ArenaPool so that the folds and the next proofs
+// (also the ones running concurrently) reuse the memory instead of going back
+// to malloc row by row. the idle memory is bounded by kMaxCount and kMaxBytes,
+// the pool is shared by all the provers so only a top level driver which
+// knows that no prover is running should call ArenaPool::Clear().
+namespace misc {
+
+class Arena : boost::noncopyable {
+ public:
+  enum { kAlign = 64, kHugePageSize = 2 * 1024 * 1024 };
+
+  Arena(size_t capacity, bool huge_pages) {
+    capacity_ = AlignUp(std::max<size_t>(capacity, kAlign), kAlign);
+#ifdef __linux__
+    if (huge_pages) {
+      capacity_ = AlignUp(capacity_, kHugePageSize);
+      void* p = mmap(nullptr, capacity_, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (p != MAP_FAILED) {
+        madvise(p, capacity_, MADV_HUGEPAGE);
+        data_ = (uint8_t*)p;
+        mmaped_ = true;
+        if (MEM_PROFILE) mem::OnAlloc(capacity_);
+        return;
+      }
+    }
+#else
+    (void)huge_pages;
+#endif
+    buf_.reset(new uint8_t[capacity_ + kAlign]);
+    data_ = (uint8_t*)AlignUp((size_t)buf_.get(), kAlign);
+  }
+
+  ~Arena() {
+#ifdef __linux__
+    if (mmaped_) {
+      munmap(data_, capacity_);
+      if (MEM_PROFILE) mem::OnFree(capacity_);
+    }
+#endif
+  }
+
+  // return nullptr if the arena is exhausted
+  void* Alloc(size_t bytes) {
+    bytes = AlignUp(bytes, kAlign);
+    if (used_ + bytes > capacity_) return nullptr;
+    void* p = data_ + used_;
+    used_ += bytes;
+    return p;
+  }
+
+  void Reset() { used_ = 0; }
+
+  size_t capacity() const { return capacity_; }
+  size_t used() const { return used_; }
+  bool huge_pages() const { return mmaped_; }
+
+  static size_t AlignUp(size_t v, size_t align) {
+    return (v + align - 1) / align * align;
+  }
+
+ private:
+  std::unique_ptr<uint8_t[]> buf_;
+  uint8_t* data_ = nullptr;
+  size_t capacity_ = 0;
+  size_t used_ = 0;
+  bool mmaped_ = false;
+};
+
+typedef std::shared_ptr<Arena> ArenaPtr;
+
+class ArenaPool {
+ public:
+  // keep at most kMaxCount arenas and kMaxBytes bytes for reuse
+  enum { kMaxCount = 16 };
+  static constexpr size_t kMaxBytes = 1ULL * 1024 * 1024 * 1024;
+
+  // the arena goes back to the pool when the last owner releases it
+  static ArenaPtr Acquire(size_t bytes) {
+    auto& pool = Instance();
+    Arena* arena = pool.Take(bytes);
+    if (!arena) arena = new Arena(bytes, debug::flags::huge_pages);
+    return ArenaPtr(arena, [](Arena* p) { Instance().Recycle(p); });
+  }
+
+  // drops the idle arenas, the ones still owned by a matrix are not touched
+  static void Clear() {
+    auto& pool = Instance();
+    std::lock_guard<std::mutex> lock(pool.mutex_);
+    pool.arenas_.clear();
+    pool.bytes_ = 0;
+  }
+
+ private:
+  static ArenaPool& Instance() {
+    static ArenaPool instance;
+    return instance;
+  }
+
+  // the smallest cached arena which is large enough
+  Arena* Take(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t best = arenas_.size();
+    for (size_t i = 0; i < arenas_.size(); ++i) {
+      auto c = arenas_[i]->capacity();
+      if (c < bytes) continue;
+      if (best == arenas_.size() || c < arenas_[best]->capacity()) best = i;
+    }
+    if (best == arenas_.size()) return nullptr;
+    Arena* ret = arenas_[best].release();
+    arenas_.erase(arenas_.begin() + best);
+    bytes_ -= ret->capacity();
+    ret->Reset();
+    return ret;
+  }
+
+  void Recycle(Arena* p) {
+    std::unique_ptr<Arena> arena(p);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (arenas_.size() >= kMaxCount || bytes_ + p->capacity() > kMaxBytes) {
+      return;
+    }
+    bytes_ += p->capacity();
+    arenas_.emplace_back(std::move(arena));
+  }
+
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<Arena>> arenas_;
+  size_t bytes_ = 0;
+};
+
+}  // namespace misc
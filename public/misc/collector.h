@@ -0,0 +1,123 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "public.h"
+
+// collects the items emitted by parallel tasks. every thread pushes onto its
+// own segment (a lock free stack), the items are moved once into a node and
+// never under a lock. take() detaches all the segments with one exchange each
+// and may run while the producers are still adding.
+// capacity > 0 bounds the items held at once, emplace blocks until take()
+// releases room (so it only makes sense with a concurrent consumer).
+namespace misc {
+
+template <typename T>
+class Collector : boost::noncopyable {
+ public:
+  explicit Collector(size_t capacity = 0) : capacity_(capacity) {
+    for (auto& i : heads_) i.store(nullptr, std::memory_order_relaxed);
+  }
+
+  ~Collector() {
+    for (auto& i : heads_) Free(i.exchange(nullptr));
+  }
+
+  void emplace(T&& item) {
+    if (capacity_) Reserve();
+    auto node = new Node{std::move(item), nullptr};
+    auto& head = heads_[Segment()];
+    node->next = head.load(std::memory_order_relaxed);
+    while (!head.compare_exchange_weak(node->next, node,
+                                       std::memory_order_release,
+                                       std::memory_order_relaxed)) {
+    }
+  }
+
+  // items in no particular order
+  void take(std::vector<T>& items) {
+    items.clear();
+    size_t count = 0;
+    for (auto& i : heads_) {
+      auto node = i.exchange(nullptr, std::memory_order_acquire);
+      // the stack is lifo, reverse it to keep the order of one thread
+      std::vector<T> segment;
+      while (node) {
+        segment.emplace_back(std::move(node->item));
+        auto next = node->next;
+        delete node;
+        node = next;
+      }
+      count += segment.size();
+      items.insert(items.end(), std::make_move_iterator(segment.rbegin()),
+                   std::make_move_iterator(segment.rend()));
+    }
+    if (capacity_ && count) Release(count);
+  }
+
+  // items ordered by key(item), so the order does not depend on the threads.
+  // the keys should be unique.
+  template <typename K>
+  void take(std::vector<T>& items, K const& key) {
+    take(items);
+    std::stable_sort(items.begin(), items.end(),
+                     [&key](T const& a, T const& b) { return key(a) < key(b); });
+  }
+
+ private:
+  enum { kSegments = 64 };
+
+  struct Node {
+    T item;
+    Node* next;
+  };
+
+  static void Free(Node* node) {
+    while (node) {
+      auto next = node->next;
+      delete node;
+      node = next;
+    }
+  }
+
+  static size_t Segment() {
+    static std::atomic<size_t> next_id{0};
+    static thread_local size_t id = next_id++;
+    return id % kSegments;
+  }
+
+  void Reserve() {
+    auto count = count_.load(std::memory_order_relaxed);
+    for (;;) {
+      if (count < capacity_) {
+        if (count_.compare_exchange_weak(count, count + 1)) return;
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this]() { return count_.load() < capacity_; });
+      count = count_.load(std::memory_order_relaxed);
+    }
+  }
+
+  void Release(size_t count) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      count_ -= count;
+    }
+    cv_.notify_all();
+  }
+
+  size_t const capacity_;
+  std::array<std::atomic<Node*>, kSegments> heads_;
+  std::atomic<size_t> count_{0};
+  std::mutex mutex_;
+  std::condition_variable cv_;
+};
+
+}  // namespace misc
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <type_traits>
+#include <vector>
+
+#include "./arena.h"
+#include "./debug.h"
+#include "log/tick.h"
+#include "parallel/parallel.h"
+
+// row major matrix with variable row length, the rows live in one or more
+// arenas. a row is only a view (data, size), so Permute/Align/Append/Fold just
+// remap the views and never move the elements.
+namespace misc {
+
+template <typename T>
+class Matrix {
+  static_assert(std::is_trivially_destructible<T>::value, "");
+
+ public:
+  struct Row {
+    T* data_ = nullptr;
+    size_t size_ = 0;
+
+    T* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    T& operator[](size_t i) const { return data_[i]; }
+    T* begin() const { return data_; }
+    T* end() const { return data_ + size_; }
+    std::vector<T> to_vector() const { return std::vector<T>(begin(), end()); }
+  };
+
+  Matrix() {}
+
+  Matrix(size_t m, size_t n) { Init(std::vector<size_t>(m, n)); }
+
+  explicit Matrix(std::vector<size_t> const& mn) { Init(mn); }
+
+  // the rows of v are released as soon as they are copied
+  explicit Matrix(std::vector<std::vector<T>>&& v) {
+    std::vector<size_t> mn(v.size());
+    for (size_t i = 0; i < v.size(); ++i) mn[i] = v[i].size();
+    Init(mn);
+    auto pf = [this, &v](int64_t i) {
+      std::copy(v[i].begin(), v[i].end(), rows_[i].data());
+      std::vector<T>().swap(v[i]);
+    };
+    parallel::For((int64_t)v.size(), pf, v.size() < 16);
+    std::vector<std::vector<T>>().swap(v);
+  }
+
+  Matrix(Matrix&&) = default;
+  Matrix& operator=(Matrix&&) = default;
+  Matrix(Matrix const&) = delete;
+  Matrix& operator=(Matrix const&) = delete;
+
+  // new matrix with the same row lengths
+  static Matrix SameShape(Matrix const& other) {
+    return Matrix(other.row_sizes());
+  }
+
+  int64_t m() const { return (int64_t)rows_.size(); }
+  bool empty() const { return rows_.empty(); }
+
+  size_t max_n() const {
+    size_t ret = 0;
+    for (auto const& i : rows_) ret = std::max(ret, i.size());
+    return ret;
+  }
+
+  std::vector<size_t> row_sizes() const {
+    std::vector<size_t> ret(rows_.size());
+    for (size_t i = 0; i < rows_.size(); ++i) ret[i] = rows_[i].size();
+    return ret;
+  }
+
+  Row const& operator[](size_t i) const { return rows_[i]; }
+  Row const& row(size_t i) const { return rows_[i]; }
+
+  // row i = old row order[i]
+  void Permute(std::vector<size_t> const& order) {
+    CHECK(order.size() == rows_.size(), "");
+    std::vector<Row> rows(rows_.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+      rows[i] = rows_[order[i]];
+    }
+    rows_.swap(rows);
+  }
+
+  // append empty rows up to new_m
+  void Align(size_t new_m) {
+    if (new_m > rows_.size()) rows_.resize(new_m);
+  }
+
+  void Append(Matrix&& other) {
+    rows_.insert(rows_.end(), other.rows_.begin(), other.rows_.end());
+    arenas_.insert(arenas_.end(), other.arenas_.begin(), other.arenas_.end());
+    other.rows_.clear();
+    other.arenas_.clear();
+  }
+
+  // row i = f(row 2i, row 2i+1), computed in place on the storage of row 2i,
+  // so row 2i must not be shorter than row 2i+1 (sort the rows first).
+  // f(Row const& dst, Row const& src)
+  template <typename F>
+  void FoldPairs(F const& f, bool direct = false) {
+    CHECK(rows_.size() % 2 == 0, "");
+    auto m2 = rows_.size() / 2;
+    auto pf = [this, &f](int64_t i) {
+      auto const& dst = rows_[2 * i];
+      auto const& src = rows_[2 * i + 1];
+      assert(dst.size() >= src.size());
+      f(dst, src);
+    };
+    parallel::For((int64_t)m2, pf, direct);
+    KeepEvenRows();
+  }
+
+  // row i = row 2i, for the callers which folded the pairs by themselves
+  void KeepEvenRows() {
+    CHECK(rows_.size() % 2 == 0, "");
+    auto m2 = rows_.size() / 2;
+    for (size_t i = 0; i < m2; ++i) rows_[i] = rows_[2 * i];
+    rows_.resize(m2);
+  }
+
+  std::vector<std::vector<T>> ToVectors() const {
+    std::vector<std::vector<T>> ret(rows_.size());
+    for (size_t i = 0; i < rows_.size(); ++i) ret[i] = rows_[i].to_vector();
+    return ret;
+  }
+
+ private:
+  void Init(std::vector<size_t> const& mn) {
+    size_t bytes = 0;
+    for (auto n : mn) bytes += Arena::AlignUp(n * sizeof(T), Arena::kAlign);
+    rows_.resize(mn.size());
+    if (!bytes) return;
+
+    auto arena = ArenaPool::Acquire(bytes);
+    for (size_t i = 0; i < mn.size(); ++i) {
+      auto& row = rows_[i];
+      row.size_ = mn[i];
+      if (!row.size_) continue;
+      row.data_ = (T*)arena->Alloc(row.size_ * sizeof(T));
+      CHECK(row.data_, "");
+      new (row.data_) T[row.size_];
+    }
+    arenas_.push_back(std::move(arena));
+  }
+
+  std::vector<Row> rows_;
+  std::vector<ArenaPtr> arenas_;
+};
+
+}  // namespace misc
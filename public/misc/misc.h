@@ -1,5 +1,6 @@
 #pragma once
 
+#include "./collector.h"
 #include "./debug.h"
 #include "./funcs.h"
 #include "./mpz.h"
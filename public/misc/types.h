@@ -50,20 +50,3 @@ inline bool operator==(Range const& a, Range const& b) {
 inline bool operator!=(Range const& a, Range const& b) {
   return a.start != b.start || a.count != b.count;
 }
-
-template <typename T>
-class SafeVec {
- public:
-  void emplace(T&& item) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    items_.emplace_back(std::move(item));
-  }
-  void take(std::vector<T>& items) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    items = std::move(items_);
-  }
-
- private:
-  std::vector<T> items_;
-  std::mutex mutex_;
-};
\ No newline at end of file